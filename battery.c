@@ -0,0 +1,247 @@
+/* See LICENSE file for copyright and license details. */
+/* power_supply batteries and adapters, one uevent pread each */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "battery.h"
+
+#ifndef POWERDIR
+#define POWERDIR "/sys/class/power_supply"
+#endif
+
+#define KEY(k) "POWER_SUPPLY_" k "="
+
+static int readuevent(int fd, char *buf, size_t size);
+static const char *field(const char *buf, const char *key);
+static long long number(const char *buf, const char *key);
+static long long magnitude(const char *buf, const char *key);
+static void closeall(BatterySet *set);
+static int parsebattery(Battery *b, const char *buf);
+
+static int
+readuevent(int fd, char *buf, size_t size)
+{
+	ssize_t len;
+
+	if ((len = pread(fd, buf, size - 1, 0)) <= 0)
+		return -1;
+	buf[len] = '\0';
+	return 0;
+}
+
+/* the value of key, which must start a line */
+static const char *
+field(const char *buf, const char *key)
+{
+	const char *p;
+	size_t len;
+
+	len = strlen(key);
+	for (p = buf; p; p = (p = strchr(p, '\n')) ? p + 1 : NULL)
+		if (!strncmp(p, key, len))
+			return p + len;
+	return NULL;
+}
+
+static long long
+number(const char *buf, const char *key)
+{
+	const char *v;
+
+	return (v = field(buf, key)) ? strtoll(v, NULL, 10) : -1;
+}
+
+/*
+ * A rate without its sign: some drivers report power_now and
+ * current_now negative while discharging, and direction comes from
+ * the status anyway. -1 still means absent.
+ */
+static long long
+magnitude(const char *buf, const char *key)
+{
+	const char *v;
+	long long n;
+
+	if (!(v = field(buf, key)))
+		return -1;
+	n = strtoll(v, NULL, 10);
+	return n < 0 ? -n : n;
+}
+
+static void
+closeall(BatterySet *set)
+{
+	int i;
+
+	for (i = 0; i < set->n; i++)
+		close(set->b[i].fd);
+	for (i = 0; i < set->nmains; i++)
+		close(set->mainsfd[i]);
+	set->n = set->nmains = 0;
+}
+
+/*
+ * Everything comes from the one uevent buffer. Drivers report either
+ * energy (µWh, µW) or charge (µAh, µA); the latter is converted with
+ * the present voltage.
+ */
+static int
+parsebattery(Battery *b, const char *buf)
+{
+	const char *v;
+	long long volt, charge, full, current;
+	size_t n;
+
+	b->capacity = number(buf, KEY("CAPACITY"));
+	strcpy(b->status, "Unknown");
+	if ((v = field(buf, KEY("STATUS")))) {
+		n = strcspn(v, "\n");
+		if (n >= sizeof(b->status))
+			n = sizeof(b->status) - 1;
+		memcpy(b->status, v, n);
+		b->status[n] = '\0';
+	}
+
+	b->energy = number(buf, KEY("ENERGY_NOW"));
+	b->energyfull = number(buf, KEY("ENERGY_FULL"));
+	b->power = magnitude(buf, KEY("POWER_NOW"));
+	volt = number(buf, KEY("VOLTAGE_NOW"));
+	if (volt > 0) {
+		if (b->energy < 0 && (charge = number(buf, KEY("CHARGE_NOW"))) >= 0)
+			b->energy = charge * volt / 1000000;
+		if (b->energyfull < 0 && (full = number(buf, KEY("CHARGE_FULL"))) >= 0)
+			b->energyfull = full * volt / 1000000;
+		if (b->power < 0 && (current = magnitude(buf, KEY("CURRENT_NOW"))) >= 0)
+			b->power = current * volt / 1000000;
+	}
+	if (b->capacity < 0 && b->energy >= 0 && b->energyfull > 0)
+		b->capacity = b->energy * 100 / b->energyfull;
+	return b->capacity >= 0 ? 0 : -1;
+}
+
+/*
+ * Find every system battery and AC adapter once and hold their uevent
+ * files. Batteries with a Device scope belong to mice and keyboards and
+ * are left out.
+ */
+int
+batscan(BatterySet *set)
+{
+	char buf[2048];
+	struct dirent *e;
+	const char *type;
+	Battery *b;
+	size_t n;
+	DIR *d;
+	int fd, dfd;
+
+	closeall(set);
+	set->scanned = 1;
+	if (!(d = opendir(POWERDIR)))
+		return 0;
+	while ((e = readdir(d))) {
+		if (e->d_name[0] == '.' ||
+		    (dfd = openat(dirfd(d), e->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+			continue;
+		fd = openat(dfd, "uevent", O_RDONLY | O_CLOEXEC);
+		close(dfd);
+		if (fd < 0)
+			continue;
+		if (readuevent(fd, buf, sizeof(buf)) < 0 || !(type = field(buf, KEY("TYPE")))) {
+			close(fd);
+			continue;
+		}
+		if (!strncmp(type, "Battery\n", 8) && set->n < BATMAX) {
+			if ((type = field(buf, KEY("SCOPE"))) && !strncmp(type, "Device", 6)) {
+				close(fd);
+				continue;
+			}
+			b = &set->b[set->n++];
+			b->fd = fd;
+			n = strnlen(e->d_name, sizeof(b->name) - 1);
+			memcpy(b->name, e->d_name, n);
+			b->name[n] = '\0';
+		} else if (!strncmp(type, "Mains\n", 6) && set->nmains < BATMAX) {
+			set->mainsfd[set->nmains++] = fd;
+		} else {
+			close(fd);
+		}
+	}
+	closedir(d);
+	return set->n;
+}
+
+/*
+ * One pread per held uevent, then the batteries are combined: charge
+ * is total energy over total capacity, and the time left is the energy
+ * to go, down to empty or up to full, over the combined power.
+ */
+int
+batread(BatterySet *set, BatteryTotal *tot)
+{
+	char buf[2048];
+	long long energy, full, power;
+	Battery *b;
+	int i, n, capsum, charging, discharging;
+
+	if (!set->scanned)
+		batscan(set);
+
+	memset(tot, 0, sizeof(*tot));
+	tot->minutes = -1;
+	strcpy(tot->status, "Unknown");
+
+	tot->ac = set->nmains ? 0 : -1;
+	for (i = 0; i < set->nmains; i++)
+		if (readuevent(set->mainsfd[i], buf, sizeof(buf)) == 0 && number(buf, KEY("ONLINE")) == 1)
+			tot->ac = 1;
+
+	energy = full = power = 0;
+	n = capsum = charging = discharging = 0;
+	for (i = 0; i < set->n; i++) {
+		b = &set->b[i];
+		if (readuevent(b->fd, buf, sizeof(buf)) < 0) {
+			/* the battery was pulled; find out what is left next time */
+			if (errno == ENODEV)
+				set->scanned = 0;
+			continue;
+		}
+		if (parsebattery(b, buf) < 0)
+			continue;
+		n++;
+		capsum += b->capacity;
+		charging |= !strcmp(b->status, "Charging");
+		discharging |= !strcmp(b->status, "Discharging");
+		if (full >= 0 && b->energy >= 0 && b->energyfull > 0) {
+			energy += b->energy;
+			full += b->energyfull;
+		} else {
+			full = -1;
+		}
+		if (b->power > 0)
+			power += b->power;
+		if (n == 1)
+			strcpy(tot->status, b->status);
+	}
+	if (!(tot->n = n))
+		return 0;
+
+	if (charging)
+		strcpy(tot->status, "Charging");
+	else if (discharging)
+		strcpy(tot->status, "Discharging");
+	tot->percent = full > 0 ? (int)(energy * 100 / full) : capsum / n;
+	tot->watts = power / 1e6;
+	if (full > 0 && power > 0) {
+		if (discharging && !charging)
+			tot->minutes = energy * 60 / power;
+		else if (charging)
+			tot->minutes = (full - energy) * 60 / power;
+	}
+	return n;
+}
@@ -0,0 +1,34 @@
+/* See LICENSE file for copyright and license details. */
+
+#define BATMAX 8
+
+typedef struct {
+	int fd;                  /* held uevent */
+	char name[16];
+	int capacity;            /* percent, -1 when not reported */
+	char status[16];         /* Charging, Discharging, Full, ... */
+	long long energy;        /* µWh now, -1 when unknown */
+	long long energyfull;    /* µWh when full, -1 when unknown */
+	long long power;         /* µW drawn or supplied, -1 when unknown */
+} Battery;
+
+typedef struct {
+	Battery b[BATMAX];
+	int n;
+	int mainsfd[BATMAX];     /* held uevents of AC adapters */
+	int nmains;
+	int scanned;             /* discovery has run since the last failure */
+} BatterySet;
+
+/* all system batteries taken together */
+typedef struct {
+	int n;
+	int percent;
+	char status[16];
+	double watts;            /* 0 when unknown */
+	int minutes;             /* to empty or to full, -1 when unknown */
+	int ac;                  /* some adapter reports online, -1 without adapters */
+} BatteryTotal;
+
+int batscan(BatterySet *set);
+int batread(BatterySet *set, BatteryTotal *tot);
@@ -0,0 +1,88 @@
+/* See LICENSE file for copyright and license details. */
+/* the old per-line sscanf meminfo loop against parsememinfo() */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "mem.h"
+
+#define ROUNDS 200000
+
+static double now(void);
+static unsigned long oldparse(const char *buf);
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* what getmemoryinfo() did before, minus the fopen and fgets */
+static unsigned long
+oldparse(const char *buf)
+{
+	unsigned long memtotal, memfree, memavailable, buffers, cached;
+	char line[256];
+	const char *p, *e;
+	size_t n;
+
+	memtotal = memfree = memavailable = buffers = cached = 0;
+	for (p = buf; *p; p = *e ? e + 1 : e) {
+		e = p + strcspn(p, "\n");
+		n = e - p < (long)sizeof(line) - 1 ? (size_t)(e - p) : sizeof(line) - 1;
+		memcpy(line, p, n);
+		line[n] = '\0';
+		if (sscanf(line, "MemTotal: %lu kB", &memtotal) == 1) continue;
+		if (sscanf(line, "MemFree: %lu kB", &memfree) == 1) continue;
+		if (sscanf(line, "MemAvailable: %lu kB", &memavailable) == 1) continue;
+		if (sscanf(line, "Buffers: %lu kB", &buffers) == 1) continue;
+		if (sscanf(line, "Cached: %lu kB", &cached) == 1) continue;
+	}
+	return memtotal + memfree + memavailable + buffers + cached;
+}
+
+int
+main(int argc, char *argv[])
+{
+	static char buf[65536];
+	const char *path;
+	MemInfo mi;
+	FILE *fp;
+	size_t len;
+	unsigned long sink;
+	double t0, told, tnew;
+	int r;
+
+	path = argc > 1 ? argv[1] : "/proc/meminfo";
+	if (!(fp = fopen(path, "r"))) {
+		perror(path);
+		return 1;
+	}
+	len = fread(buf, 1, sizeof(buf) - 1, fp);
+	buf[len] = '\0';
+	fclose(fp);
+
+	sink = 0;
+	t0 = now();
+	for (r = 0; r < ROUNDS; r++)
+		sink += oldparse(buf);
+	told = (now() - t0) / ROUNDS;
+
+	t0 = now();
+	for (r = 0; r < ROUNDS; r++) {
+		parsememinfo(buf, &mi);
+		sink += mi.memtotal;
+	}
+	tnew = (now() - t0) / ROUNDS;
+
+	printf("%s, %zu bytes\n", path, len);
+	printf("sscanf loop:  %8.0f ns/parse (5 fields)\n", told * 1e9);
+	printf("single pass:  %8.0f ns/parse (%zu fields)  %5.1fx\n",
+	       tnew * 1e9, sizeof(mi) / sizeof(mi.memtotal), told / tnew);
+	return sink == 0;
+}
@@ -0,0 +1,113 @@
+/* See LICENSE file for copyright and license details. */
+/* procscan() over a synthetic /proc with 1, 2, 4 and 8 threads */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "proc.h"
+
+#define NPROCS 20000
+#define ROUNDS 20
+
+static void die(const char *msg);
+static double now(void);
+static void mkfixture(const char *root, int n);
+static void rmfixture(const char *root, int n);
+
+static void
+die(const char *msg)
+{
+	fprintf(stderr, "procbench: %s: %s\n", msg, strerror(errno));
+	exit(1);
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* one <pid>/stat per process, shaped like the kernel's */
+static void
+mkfixture(const char *root, int n)
+{
+	char path[256], buf[512];
+	int pid, fd, len;
+
+	for (pid = 1; pid <= n; pid++) {
+		snprintf(path, sizeof(path), "%s/%d", root, pid);
+		if (mkdir(path, 0755) < 0)
+			die(path);
+		snprintf(path, sizeof(path), "%s/%d/stat", root, pid);
+		if ((fd = open(path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0)
+			die(path);
+		len = snprintf(buf, sizeof(buf),
+		               "%d (worker %d) S 1 %d %d 0 -1 4194560 %d 0 0 0 %d %d 0 0 20 0 1 0 %d "
+		               "12345678 %d 18446744073709551615 1 1 0 0 0 0 0 4096 0 0 0 0 17 0 0 0 0 0 0\n",
+		               pid, pid, pid, pid, pid * 3, pid % 97, pid % 13, pid * 7, pid % 4096);
+		if (write(fd, buf, len) != len)
+			die(path);
+		close(fd);
+	}
+}
+
+static void
+rmfixture(const char *root, int n)
+{
+	char path[256];
+	int pid;
+
+	for (pid = 1; pid <= n; pid++) {
+		snprintf(path, sizeof(path), "%s/%d/stat", root, pid);
+		unlink(path);
+		snprintf(path, sizeof(path), "%s/%d", root, pid);
+		rmdir(path);
+	}
+	rmdir(root);
+}
+
+int
+main(int argc, char *argv[])
+{
+	static const int threads[] = { 1, 2, 4, 8 };
+	char root[] = "/tmp/procbench.XXXXXX";
+	ProcTable t;
+	double t0, dt, base;
+	int i, r, n, got;
+
+	n = argc > 1 ? atoi(argv[1]) : NPROCS;
+	if (!mkdtemp(root))
+		die("mkdtemp");
+	mkfixture(root, n);
+	printf("%d processes, %ld online cpus\n", n, sysconf(_SC_NPROCESSORS_ONLN));
+
+	base = 0;
+	for (i = 0; i < (int)(sizeof(threads) / sizeof(threads[0])); i++) {
+		memset(&t, 0, sizeof(t));
+		t.dirfd = -1;
+		/* the first scan fills the table and the page cache */
+		if ((got = procscan(&t, root, now(), threads[i])) != n)
+			fprintf(stderr, "procbench: scanned %d of %d\n", got, n);
+		t0 = now();
+		for (r = 0; r < ROUNDS; r++)
+			procscan(&t, root, now(), threads[i]);
+		dt = (now() - t0) / ROUNDS;
+		if (i == 0)
+			base = dt;
+		printf("%d threads: %8.2f ms/scan  %5.2fx\n", threads[i], dt * 1e3, base / dt);
+		close(t.dirfd);
+		free(t.slots);
+		free(t.pids);
+	}
+	rmfixture(root, n);
+	return 0;
+}
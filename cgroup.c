@@ -0,0 +1,520 @@
+/* See LICENSE file for copyright and license details. */
+/* the process's own cgroup v2 usage against its effective limits */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "cgroup.h"
+
+static int readfile(int dfd, const char *name, char *buf, size_t size);
+static int readfd(int fd, char *buf, size_t size);
+static void openlevels(CgSelf *cg, int dfd);
+static int newnode(CgTree *t);
+static void dropnode(CgTree *t, int i);
+static int relpath(const CgTree *t, int i, char *buf, size_t size);
+static int walk(CgTree *t, int parent, int pdfd, const char *name, char *path, size_t len);
+static void addchild(CgTree *t, int parent, const char *name);
+static void treeevents(CgTree *t);
+static unsigned long long iobytes(const char *p);
+static double keyof(const CgNode *c, int key);
+
+static int
+readfile(int dfd, const char *name, char *buf, size_t size)
+{
+	int fd, ret;
+
+	if ((fd = openat(dfd, name, O_RDONLY | O_CLOEXEC)) < 0)
+		return -1;
+	ret = readfd(fd, buf, size);
+	close(fd);
+	return ret;
+}
+
+static int
+readfd(int fd, char *buf, size_t size)
+{
+	ssize_t len;
+
+	if (fd < 0 || (len = pread(fd, buf, size - 1, 0)) <= 0)
+		return -1;
+	buf[len] = '\0';
+	return 0;
+}
+
+/*
+ * Where the cgroup2 hierarchy is mounted, from mountinfo. Fields are
+ * "id parent major:minor root mountpoint ... - type source options";
+ * on a hybrid host it is the unified mount next to the v1 ones.
+ */
+int
+cgmount(char *dir, size_t size)
+{
+	char buf[65536], mnt[256], type[32];
+	const char *line, *end, *sep;
+	int fd;
+
+	if ((fd = open("/proc/self/mountinfo", O_RDONLY | O_CLOEXEC)) < 0)
+		return -1;
+	if (readfd(fd, buf, sizeof(buf)) < 0) {
+		close(fd);
+		return -1;
+	}
+	close(fd);
+
+	for (line = buf; *line; line = *end ? end + 1 : end) {
+		end = line + strcspn(line, "\n");
+		if (!(sep = strstr(line, " - ")) || sep > end)
+			continue;
+		if (sscanf(sep, " - %31s", type) != 1 || strcmp(type, "cgroup2") != 0)
+			continue;
+		if (sscanf(line, "%*s %*s %*s %*s %255s", mnt) != 1)
+			continue;
+		if (strlen(mnt) >= size)
+			return -1;
+		strcpy(dir, mnt);
+		return 0;
+	}
+	return -1;
+}
+
+/* hold the limit files from the own cgroup dfd up to the root; takes dfd */
+static void
+openlevels(CgSelf *cg, int dfd)
+{
+	int mem, cpu, up;
+
+	cg->memcur = openat(dfd, "memory.current", O_RDONLY | O_CLOEXEC);
+	cg->cpustat = openat(dfd, "cpu.stat", O_RDONLY | O_CLOEXEC);
+	for (cg->nlevels = 0; cg->nlevels < CGDEPTH;) {
+		mem = openat(dfd, "memory.max", O_RDONLY | O_CLOEXEC);
+		cpu = openat(dfd, "cpu.max", O_RDONLY | O_CLOEXEC);
+		/* the root, or the directory above the mount, has no limit files */
+		if (mem < 0 && cpu < 0)
+			break;
+		cg->memmax[cg->nlevels] = mem;
+		cg->cpumax[cg->nlevels++] = cpu;
+		up = openat(dfd, "..", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+		close(dfd);
+		if ((dfd = up) < 0)
+			return;
+	}
+	close(dfd);
+}
+
+/*
+ * Find the process's cgroup from the "0::" line of /proc/self/cgroup,
+ * which only exists for cgroup v2, and open it under the cgroup2 mount.
+ */
+int
+cgopen(CgSelf *cg)
+{
+	char buf[4096], dir[512];
+	const char *p;
+	size_t n;
+	int dfd;
+
+	memset(cg, 0, sizeof(*cg));
+	cg->memcur = cg->cpustat = -1;
+	if (readfile(AT_FDCWD, "/proc/self/cgroup", buf, sizeof(buf)) < 0)
+		return -1;
+	if (!strncmp(buf, "0::", 3))
+		p = buf + 3;
+	else if ((p = strstr(buf, "\n0::")))
+		p += 4;
+	else
+		return -1;
+	n = strcspn(p, "\n");
+	if (n >= sizeof(cg->path))
+		return -1;
+	memcpy(cg->path, p, n);
+	cg->path[n] = '\0';
+
+	if (cgmount(dir, sizeof(dir) - sizeof(cg->path)) < 0)
+		return -1;
+	strcat(dir, cg->path);
+	if ((dfd = open(dir, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+		return -1;
+	openlevels(cg, dfd);
+	cg->found = 1;
+	return 0;
+}
+
+/*
+ * Read usage and the tightest limit on the way up: memory.max is a
+ * byte count or "max", cpu.max is "quota period" with "max" for no
+ * quota. CPU use is the usage_usec delta over the wall-clock interval.
+ */
+int
+cgsample(CgSelf *cg, CgUsage *u, double now)
+{
+	char buf[1024], *p;
+	unsigned long long v, usage;
+	double quota, period, cpus;
+	int i;
+
+	memset(u, 0, sizeof(*u));
+	if (!cg->found)
+		return -1;
+
+	if (readfd(cg->memcur, buf, sizeof(buf)) == 0)
+		u->memcurrent = strtoull(buf, NULL, 10);
+	for (i = 0; i < cg->nlevels; i++) {
+		if (readfd(cg->memmax[i], buf, sizeof(buf)) == 0 && strncmp(buf, "max", 3) != 0) {
+			v = strtoull(buf, NULL, 10);
+			if (!u->memmax || v < u->memmax)
+				u->memmax = v;
+		}
+		if (readfd(cg->cpumax[i], buf, sizeof(buf)) == 0 && strncmp(buf, "max", 3) != 0 &&
+		    sscanf(buf, "%lf %lf", &quota, &period) == 2 && period > 0) {
+			cpus = quota / period;
+			if (!u->cpulimit || cpus < u->cpulimit)
+				u->cpulimit = cpus;
+		}
+	}
+
+	if (readfd(cg->cpustat, buf, sizeof(buf)) == 0 && (p = strstr(buf, "usage_usec "))) {
+		usage = strtoull(p + 11, NULL, 10);
+		if (cg->prevt > 0 && now > cg->prevt && usage >= cg->prevusage)
+			u->cpuused = (usage - cg->prevusage) / 1e6 / (now - cg->prevt);
+		cg->prevusage = usage;
+		cg->prevt = now;
+	}
+	u->valid = cg->memcur >= 0 || cg->cpustat >= 0;
+	return u->valid ? 0 : -1;
+}
+
+static int
+newnode(CgTree *t)
+{
+	CgNode *nodes;
+	int i, cap;
+
+	/* slots are only freed when cgroups go away, so the scan is rare */
+	if (t->nfree > 0) {
+		for (i = 0; i < t->n; i++) {
+			if (t->nodes[i].parent == -2) {
+				t->nfree--;
+				return i;
+			}
+		}
+	}
+	if (t->n == t->cap) {
+		cap = t->cap ? t->cap * 2 : 64;
+		if (!(nodes = realloc(t->nodes, cap * sizeof(*nodes))))
+			return -1;
+		t->nodes = nodes;
+		t->cap = cap;
+	}
+	return t->n++;
+}
+
+static void
+dropnode(CgTree *t, int i)
+{
+	CgNode *c = &t->nodes[i];
+
+	if (c->wd >= 0)
+		inotify_rm_watch(t->infd, c->wd);
+	if (c->cpustat >= 0)
+		close(c->cpustat);
+	if (c->memcur >= 0)
+		close(c->memcur);
+	if (c->iostat >= 0)
+		close(c->iostat);
+	memset(c, 0, sizeof(*c));
+	c->wd = c->cpustat = c->memcur = c->iostat = -1;
+	c->parent = -2;
+	t->nfree++;
+}
+
+/* the path below the mount, "" for the root */
+static int
+relpath(const CgTree *t, int i, char *buf, size_t size)
+{
+	size_t len, pos;
+	int j;
+
+	pos = size - 1;
+	buf[pos] = '\0';
+	for (j = i; t->nodes[j].parent >= 0; j = t->nodes[j].parent) {
+		len = strlen(t->nodes[j].name);
+		if (len + 1 > pos)
+			return -1;
+		if (pos < size - 1)
+			buf[--pos] = '/';
+		pos -= len;
+		memcpy(buf + pos, t->nodes[j].name, len);
+	}
+	memmove(buf, buf + pos, size - pos);
+	return 0;
+}
+
+/*
+ * Add the directory name under pdfd and everything below it. path is
+ * its parent's absolute path, len long, and is extended in place for
+ * inotify. The watch goes on before the listing, so a child created
+ * in between shows up in both and is deduplicated by addchild().
+ */
+static int
+walk(CgTree *t, int parent, int pdfd, const char *name, char *path, size_t len)
+{
+	struct dirent *de;
+	CgNode *c;
+	DIR *d;
+	size_t n;
+	int i, dfd;
+
+	n = strlen(name);
+	if (parent >= 0 && len + 1 + n >= PATH_MAX)
+		return -1;
+	if ((dfd = openat(pdfd, name, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+		return -1;
+	if ((i = newnode(t)) < 0) {
+		close(dfd);
+		return -1;
+	}
+	if (parent >= 0) {
+		path[len] = '/';
+		memcpy(path + len + 1, name, n + 1);
+		len += 1 + n;
+	}
+
+	c = &t->nodes[i];
+	memset(c, 0, sizeof(*c));
+	if (parent >= 0)
+		memcpy(c->name, name, n + 1);
+	c->parent = parent;
+	c->wd = inotify_add_watch(t->infd, path, IN_CREATE | IN_ONLYDIR);
+	c->cpustat = openat(dfd, "cpu.stat", O_RDONLY | O_CLOEXEC);
+	c->memcur = openat(dfd, "memory.current", O_RDONLY | O_CLOEXEC);
+	c->iostat = openat(dfd, "io.stat", O_RDONLY | O_CLOEXEC);
+
+	if (!(d = fdopendir(dfd))) {
+		close(dfd);
+		return i;
+	}
+	while ((de = readdir(d))) {
+		if (de->d_type != DT_DIR || !strcmp(de->d_name, ".") || !strcmp(de->d_name, ".."))
+			continue;
+		walk(t, i, dirfd(d), de->d_name, path, len);
+		path[len] = '\0';
+	}
+	closedir(d);
+	return i;
+}
+
+static void
+addchild(CgTree *t, int parent, const char *name)
+{
+	char path[PATH_MAX], rel[PATH_MAX];
+	size_t len;
+	int i, pdfd;
+
+	for (i = 0; i < t->n; i++)
+		if (t->nodes[i].parent == parent && !strcmp(t->nodes[i].name, name))
+			return;
+	if (relpath(t, parent, rel, sizeof(rel)) < 0)
+		return;
+	if ((pdfd = openat(t->mountfd, rel[0] ? rel : ".", O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+		return;
+	len = snprintf(path, sizeof(path), "%s%s%s", t->mount, rel[0] ? "/" : "", rel);
+	if (len < sizeof(path))
+		walk(t, parent, pdfd, name, path, len);
+	close(pdfd);
+}
+
+/*
+ * New cgroups arrive as IN_CREATE on their parent and removed ones as
+ * IN_IGNORED on their own watch, so only the changed subtree is walked.
+ * An overflowed queue may have lost either, so the tree is rebuilt.
+ */
+static void
+treeevents(CgTree *t)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	char path[PATH_MAX];
+	const struct inotify_event *ev;
+	ssize_t len;
+	char *p;
+	int i, rebuild;
+
+	rebuild = 0;
+	for (;;) {
+		if ((len = read(t->infd, buf, sizeof(buf))) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		if (len == 0)
+			break;
+		for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)p;
+			if (ev->mask & IN_Q_OVERFLOW) {
+				rebuild = 1;
+				continue;
+			}
+			for (i = 0; i < t->n; i++)
+				if (t->nodes[i].wd == ev->wd && t->nodes[i].parent != -2)
+					break;
+			if (i == t->n)
+				continue;
+			if (ev->mask & IN_IGNORED) {
+				t->nodes[i].wd = -1;
+				dropnode(t, i);
+			} else if ((ev->mask & IN_CREATE) && (ev->mask & IN_ISDIR) && ev->len) {
+				addchild(t, i, ev->name);
+			}
+		}
+	}
+	if (!rebuild)
+		return;
+	for (i = 0; i < t->n; i++)
+		if (t->nodes[i].parent != -2)
+			dropnode(t, i);
+	t->n = t->nfree = 0;
+	strcpy(path, t->mount);
+	walk(t, -1, t->mountfd, ".", path, strlen(path));
+}
+
+/* rbytes plus wbytes over every device line of io.stat */
+static unsigned long long
+iobytes(const char *p)
+{
+	unsigned long long sum;
+
+	sum = 0;
+	while ((p = strstr(p, "bytes="))) {
+		if (p[-1] == 'r' || p[-1] == 'w')
+			sum += strtoull(p + 6, NULL, 10);
+		p += 6;
+	}
+	return sum;
+}
+
+/*
+ * Walk the cgroup2 hierarchy once, then keep it current from inotify
+ * and only re-read the held stat files. cpu.stat exists in every
+ * cgroup, so failing to read it means the cgroup is gone.
+ */
+int
+cgtreescan(CgTree *t, double now)
+{
+	char buf[8192], path[PATH_MAX];
+	unsigned long long usage, io;
+	CgNode *c;
+	double dt;
+	int i, live;
+
+	if (!t->scanned) {
+		t->scanned = 1;
+		if (cgmount(t->mount, sizeof(t->mount)) < 0)
+			return -1;
+		if ((t->infd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC)) < 0)
+			return -1;
+		if ((t->mountfd = open(t->mount, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+			return -1;
+		strcpy(path, t->mount);
+		walk(t, -1, t->mountfd, ".", path, strlen(path));
+	} else if (t->mountfd < 0) {
+		return -1;
+	} else {
+		treeevents(t);
+	}
+
+	dt = t->last > 0 ? now - t->last : 0;
+	t->last = now;
+	live = 0;
+	for (i = 0; i < t->n; i++) {
+		c = &t->nodes[i];
+		if (c->parent == -2)
+			continue;
+		if (readfd(c->cpustat, buf, sizeof(buf)) < 0) {
+			if (c->parent >= 0)
+				dropnode(t, i);
+			continue;
+		}
+		usage = strncmp(buf, "usage_usec ", 11) ? 0 : strtoull(buf + 11, NULL, 10);
+		io = readfd(c->iostat, buf, sizeof(buf)) == 0 ? iobytes(buf) : 0;
+		c->mem = readfd(c->memcur, buf, sizeof(buf)) == 0 ? strtoull(buf, NULL, 10) : 0;
+		c->cpu = c->seen && dt > 0 && usage >= c->usage ? (usage - c->usage) / 1e6 / dt : 0;
+		c->io = c->seen && dt > 0 && io >= c->iobytes ? (io - c->iobytes) / dt : 0;
+		c->usage = usage;
+		c->iobytes = io;
+		c->seen = 1;
+		live++;
+	}
+	return live;
+}
+
+static double
+keyof(const CgNode *c, int key)
+{
+	switch (key) {
+	case CgByMem: return c->mem;
+	case CgByIo:  return c->io;
+	default:      return c->cpu;
+	}
+}
+
+/* the n heaviest cgroups below the root, heaviest first */
+int
+cgtreetop(const CgTree *t, CgStat *top, int n, int key)
+{
+	char rel[PATH_MAX];
+	int idx[64];
+	int i, j, c, count, tmp;
+	size_t len;
+	const CgNode *cn;
+
+	if (n > (int)(sizeof(idx) / sizeof(idx[0])))
+		n = sizeof(idx) / sizeof(idx[0]);
+	count = 0;
+	for (i = 0; i < t->n && n > 0; i++) {
+		if (t->nodes[i].parent < 0)
+			continue;
+		if (count < n) {
+			/* a min-heap of the winners so far */
+			for (j = count++; j > 0 && keyof(&t->nodes[idx[(j - 1) / 2]], key) > keyof(&t->nodes[i], key); j = (j - 1) / 2)
+				idx[j] = idx[(j - 1) / 2];
+			idx[j] = i;
+		} else if (keyof(&t->nodes[i], key) > keyof(&t->nodes[idx[0]], key)) {
+			for (j = 0; (c = 2 * j + 1) < count; j = c) {
+				if (c + 1 < count && keyof(&t->nodes[idx[c + 1]], key) < keyof(&t->nodes[idx[c]], key))
+					c++;
+				if (keyof(&t->nodes[i], key) <= keyof(&t->nodes[idx[c]], key))
+					break;
+				idx[j] = idx[c];
+			}
+			idx[j] = i;
+		}
+	}
+
+	for (j = 1; j < count; j++) {
+		tmp = idx[j];
+		for (c = j; c > 0 && keyof(&t->nodes[tmp], key) > keyof(&t->nodes[idx[c - 1]], key); c--)
+			idx[c] = idx[c - 1];
+		idx[c] = tmp;
+	}
+
+	for (j = 0; j < count; j++) {
+		cn = &t->nodes[idx[j]];
+		if (relpath(t, idx[j], rel, sizeof(rel)) < 0)
+			strcpy(rel, cn->name);
+		/* the end of the path is what tells siblings apart */
+		if ((len = strlen(rel)) >= sizeof(top[j].path))
+			snprintf(top[j].path, sizeof(top[j].path), "..%s",
+			         rel + len - (sizeof(top[j].path) - 3));
+		else
+			memcpy(top[j].path, rel, len + 1);
+		top[j].cpu = cn->cpu;
+		top[j].mem = cn->mem;
+		top[j].io = cn->io;
+	}
+	return count;
+}
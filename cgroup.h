@@ -0,0 +1,66 @@
+/* See LICENSE file for copyright and license details. */
+
+#include <limits.h>
+
+#define CGDEPTH 16
+
+enum { CgByCpu, CgByMem, CgByIo };
+
+/* this process's own cgroup v2 and the limit files of it and its ancestors */
+typedef struct {
+	int found;               /* the cgroup directory was opened */
+	char path[256];          /* relative to the cgroup2 mount */
+	int memcur;              /* memory.current */
+	int cpustat;             /* cpu.stat */
+	int nlevels;
+	int memmax[CGDEPTH];     /* memory.max, own cgroup first */
+	int cpumax[CGDEPTH];     /* cpu.max, own cgroup first */
+	unsigned long long prevusage;
+	double prevt;
+} CgSelf;
+
+typedef struct {
+	int valid;
+	unsigned long long memcurrent;  /* bytes */
+	unsigned long long memmax;      /* effective limit in bytes, 0 when unlimited */
+	double cpulimit;                /* effective limit in cpus, 0 when unlimited */
+	double cpuused;                 /* cpus used over the last interval */
+} CgUsage;
+
+/* one directory of the cgroup2 hierarchy with its stat files held open */
+typedef struct {
+	char name[NAME_MAX + 1];    /* "" for the mount root */
+	int parent;                 /* index, -1 for the mount root, -2 for a free slot */
+	int wd;                     /* inotify watch for children coming and going */
+	int cpustat, memcur, iostat;
+	int seen;                   /* sampled before, so the rates are valid */
+	unsigned long long usage;   /* usage_usec */
+	unsigned long long iobytes; /* read + written */
+	unsigned long long mem;     /* memory.current, 0 without the controller */
+	double cpu;                 /* cpus over the last interval */
+	double io;                  /* bytes per second */
+} CgNode;
+
+typedef struct {
+	CgNode *nodes;
+	int n, cap;                 /* slots in use, including free ones */
+	int nfree;
+	int mountfd;                /* -1 until the first scan opens it */
+	int infd;                   /* -1 until the first scan */
+	int scanned;                /* the first scan ran, whether or not it worked */
+	char mount[256];
+	double last;
+} CgTree;
+
+typedef struct {
+	char path[64];              /* the tail of the path below the mount */
+	double cpu;
+	unsigned long long mem;
+	double io;
+} CgStat;
+
+int cgmount(char *dir, size_t size);
+int cgopen(CgSelf *cg);
+int cgsample(CgSelf *cg, CgUsage *u, double now);
+int cgtreescan(CgTree *t, double now);
+int cgtreetop(const CgTree *t, CgStat *top, int n, int key);
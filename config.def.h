@@ -3,12 +3,68 @@
 /* refresh interval in seconds */
 static const int refresh_interval = 1;
 
+/*
+ * per-collector refresh periods in seconds, 0 = only when the kernel
+ * reports a change (polled every refresh_interval if it cannot)
+ */
+static const double time_period    = 1;
+static const double cpu_period     = 1;
+static const double memory_period  = 2;
+static const double uptime_period  = 10;
+static const double battery_period = 30;
+static const double netdev_period  = 1;
+static const double disk_period    = 1;
+static const double fs_period      = 5;  /* statvfs; the mount table itself is re-read on change */
+static const double fs_timeout     = 1;  /* seconds before a statvfs counts as hung */
+static const double psi_period     = 2;
+static const double proc_period    = 2;
+static const double sensor_period  = 2;
+static const double freq_period    = 2;  /* per-core frequency and throttle counts */
+static const double self_period    = 2;  /* this process's own cpu and memory */
+static const double cgroup_period  = 2;  /* own cgroup v2 usage and limits */
+static const double numa_period    = 2;  /* per-node memory and numastat */
+static const double irq_period     = 2;  /* /proc/interrupts and /proc/softirqs */
+static const double cgtree_period  = 2;  /* every cgroup; the tree itself is kept current via inotify */
+static const double dns_period     = 0;  /* resolv.conf, via inotify */
+static const double host_period    = 0;  /* user, /etc/hostname and uname, via inotify */
+static const double system_period  = 0;  /* os-release, via inotify */
+static const double net_period     = 0;  /* via netlink */
+
 /* hex background refresh interval in seconds (can be fractional) */
 static const double hex_refresh_interval = 0.5;
 
 /* enable terminal color display in hex background (1 = enabled, 0 = monochrome) */
 static const int enable_colored_hex = 1;
 
+/* optional panels, placed below the POWER box or right of the hex dump */
+static const int show_cores = 1;        /* per-core utilisation grid */
+static const int show_numa = 1;         /* per-node cpu, memory and misses, with 2+ nodes */
+static const int show_traffic = 1;      /* per-interface throughput */
+static const int traffic_rows = 6;      /* busiest interfaces listed */
+static const int show_disks = 1;        /* per-device I/O from /proc/diskstats */
+static const int disk_rows = 6;         /* busiest devices listed */
+static const int disk_partitions = 0;   /* list partitions next to whole disks */
+static const int disk_mapper = 1;       /* list device-mapper targets (LVM, dm-crypt) */
+static const int show_fs = 1;           /* filesystem capacity */
+static const int fs_rows = 8;           /* mounts listed */
+static const int show_psi = 1;          /* pressure stall information */
+static const int show_procs = 1;        /* top processes by CPU and RSS */
+static const int proc_rows = 8;         /* processes listed per column */
+static const int proc_threads = 0;      /* /proc scan threads, 0 = one per online cpu (at most 8) */
+static const int show_irqs = 1;         /* interrupt and softirq rates per cpu */
+static const int irq_rows = 6;          /* busiest interrupts shown */
+static const int softirq_rows = 4;      /* busiest softirqs shown */
+static const int show_cgroups = 1;      /* cgroup v2 tree by cpu, memory or io */
+static const int cgroup_rows = 8;       /* cgroups listed */
+static const int cgroup_sort = 0;       /* 0 = cpu, 1 = memory, 2 = io */
+static const int show_sensors = 1;      /* hwmon and thermal zone readings */
+static const int sensor_rows = 10;      /* sensors listed, temperatures first */
+static const int show_overhead = 1;     /* own cost and per-collector timings */
+/* PSI trigger: redraw once some tasks stalled this long within the window;
+ * unprivileged users need a window that is a multiple of 2s */
+static const unsigned int psi_stall_us  = 100000;
+static const unsigned int psi_window_us = 2000000;
+
 typedef struct {
 	const char *name;
 	const char **art;
@@ -29,9 +85,6 @@ static const struct {
 	[6] = { TB_WHITE,     TB_DEFAULT }, /* vpn */
 };
 
-/* battery path - adjust for your system */
-static const char *battery_path = "/sys/class/power_supply/BAT0";
-
 /* commands for power management (adjust for your system) */
 /* Common alternatives:
  * sudo systems: "sudo reboot", "sudo shutdown -h now"
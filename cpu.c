@@ -0,0 +1,174 @@
+/* See LICENSE file for copyright and license details. */
+/* per-cpu utilisation from /proc/stat */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpu.h"
+
+static int grow(CpuStat *cs, int n);
+static void delta(CpuStat *cs);
+
+static int
+grow(CpuStat *cs, int n)
+{
+	unsigned long long *p;
+	void *q;
+	int f, cap;
+
+	for (cap = cs->cap ? cs->cap : 64; cap < n; cap *= 2)
+		;
+	for (f = 0; f < CpuLast; f++) {
+		if (!(p = realloc(cs->cur[f], cap * sizeof(*p))))
+			return -1;
+		cs->cur[f] = p;
+		if (!(p = realloc(cs->prev[f], cap * sizeof(*p))))
+			return -1;
+		cs->prev[f] = p;
+	}
+	if (!(q = realloc(cs->online, cap)))
+		return -1;
+	cs->online = q;
+	if (!(q = realloc(cs->seen, cap)))
+		return -1;
+	cs->seen = q;
+	if (!(q = realloc(cs->total, cap * sizeof(*cs->total))))
+		return -1;
+	cs->total = q;
+	if (!(q = realloc(cs->busy, cap * sizeof(*cs->busy))))
+		return -1;
+	cs->busy = q;
+
+	memset(cs->online + cs->cap, 0, cap - cs->cap);
+	cs->cap = cap;
+	return 0;
+}
+
+/*
+ * Field by field across all cores, each a straight run over one array;
+ * prev becomes the deltas in place and cpusample() refills it from cur.
+ * Counters that went backwards, as iowait can on idle cores, count as
+ * zero. The breakdown sums the online cores rather than trusting the
+ * aggregate line, which inherits the same glitches.
+ */
+static void
+delta(CpuStat *cs)
+{
+	static const int guest[][2] = { { CpuUser, CpuGuest }, { CpuNice, CpuGuestNice } };
+	unsigned long long sum[CpuLast], all, *d, *total;
+	const unsigned long long *cur, *g, *idle, *iowait;
+	int i, f, n;
+
+	n = cs->ncpu;
+	for (f = 0; f < CpuLast; f++) {
+		cur = cs->cur[f];
+		d = cs->prev[f];
+		for (i = 0; i < n; i++)
+			d[i] = cur[i] > d[i] ? cur[i] - d[i] : 0;
+	}
+	for (f = 0; f < (int)(sizeof(guest) / sizeof(guest[0])); f++) {
+		d = cs->prev[guest[f][0]];
+		g = cs->prev[guest[f][1]];
+		for (i = 0; i < n; i++)
+			d[i] -= g[i] < d[i] ? g[i] : d[i];
+	}
+
+	total = cs->total;
+	memset(total, 0, n * sizeof(*total));
+	for (f = 0; f < CpuLast; f++) {
+		d = cs->prev[f];
+		sum[f] = 0;
+		for (i = 0; i < n; i++) {
+			total[i] += d[i];
+			sum[f] += d[i];
+		}
+	}
+	idle = cs->prev[CpuIdle];
+	iowait = cs->prev[CpuIowait];
+	for (i = 0; i < n; i++)
+		cs->busy[i] = total[i] ? 100.0f * (total[i] - idle[i] - iowait[i]) / total[i] : 0;
+
+	all = 0;
+	for (f = 0; f < CpuLast; f++)
+		all += sum[f];
+	for (f = 0; f < CpuLast; f++)
+		cs->times[f] = all ? 100.0f * sum[f] / all : 0;
+}
+
+/*
+ * Parse every cpuN line of a /proc/stat buffer. A cpu that is missing
+ * from the sample was taken offline; one that (re)appears starts from
+ * its current counters so its first interval reads as idle.
+ */
+int
+cpusample(CpuStat *cs, const char *buf)
+{
+	const char *p;
+	unsigned long long v;
+	int id, f, i;
+
+	if (cs->ncpu)
+		memset(cs->seen, 0, cs->ncpu);
+
+	/* the cpuN lines follow the aggregate line and precede everything else */
+	for (p = strchr(buf, '\n'); p && strncmp(++p, "cpu", 3) == 0; p = strchr(p, '\n')) {
+		p += 3;
+		for (id = 0; (unsigned)(*p - '0') < 10; p++)
+			id = id * 10 + (*p - '0');
+		if (id >= cs->cap && grow(cs, id + 1) < 0)
+			return -1;
+		if (id >= cs->ncpu) {
+			memset(cs->seen + cs->ncpu, 0, id + 1 - cs->ncpu);
+			cs->ncpu = id + 1;
+		}
+
+		for (f = 0; f < CpuLast; f++) {
+			while (*p == ' ')
+				p++;
+			for (v = 0; (unsigned)(*p - '0') < 10; p++)
+				v = v * 10 + (*p - '0');
+			cs->cur[f][id] = v;
+		}
+		cs->seen[id] = 1;
+	}
+
+	for (i = 0; i < cs->ncpu; i++) {
+		if (cs->seen[i] && !cs->online[i])
+			for (f = 0; f < CpuLast; f++)
+				cs->prev[f][i] = cs->cur[f][i];
+		else if (!cs->seen[i])
+			for (f = 0; f < CpuLast; f++)
+				cs->cur[f][i] = cs->prev[f][i] = 0;
+		cs->online[i] = cs->seen[i];
+	}
+
+	delta(cs);
+
+	for (f = 0; f < CpuLast; f++)
+		memcpy(cs->prev[f], cs->cur[f], cs->ncpu * sizeof(cs->cur[f][0]));
+	return 0;
+}
+
+int
+schedcounters(const char *buf, SchedCounters *sc)
+{
+	const char *p;
+
+	memset(sc, 0, sizeof(*sc));
+	if (!(p = strstr(buf, "\nctxt ")))
+		return -1;
+	/* ctxt, btime, processes, procs_running and procs_blocked follow each other */
+	for (p++; *p; p++) {
+		if (!strncmp(p, "ctxt ", 5))
+			sc->ctxt = strtoull(p + 5, NULL, 10);
+		else if (!strncmp(p, "processes ", 10))
+			sc->processes = strtoull(p + 10, NULL, 10);
+		else if (!strncmp(p, "procs_running ", 14))
+			sc->running = strtoul(p + 14, NULL, 10);
+		else if (!strncmp(p, "procs_blocked ", 14))
+			sc->blocked = strtoul(p + 14, NULL, 10);
+		if (!(p = strchr(p, '\n')))
+			break;
+	}
+	return 0;
+}
@@ -0,0 +1,36 @@
+/* See LICENSE file for copyright and license details. */
+
+/*
+ * /proc/stat per-cpu time fields, in file order. The kernel counts
+ * guest time in user and guest_nice in nice as well.
+ */
+enum { CpuUser, CpuNice, CpuSystem, CpuIdle, CpuIowait, CpuIrq,
+       CpuSoftirq, CpuSteal, CpuGuest, CpuGuestNice, CpuLast };
+
+/*
+ * Per-cpu counters kept as one contiguous array per field, indexed by
+ * cpu number, so the delta pass runs down each field across every core.
+ */
+typedef struct {
+	int ncpu;                           /* highest cpu number seen + 1 */
+	int cap;
+	unsigned long long *cur[CpuLast];
+	unsigned long long *prev[CpuLast];
+	unsigned char *online;              /* present in the last sample */
+	unsigned char *seen;
+	unsigned long long *total;          /* per-cpu ticks of the last interval */
+	float *busy;                        /* percent over the last interval */
+	float times[CpuLast];               /* percent of all online cpus' time, guest
+	                                       taken out of user and nice */
+} CpuStat;
+
+/* scheduler counters from the lines after the cpu block of /proc/stat */
+typedef struct {
+	unsigned long long ctxt;            /* context switches since boot */
+	unsigned long long processes;       /* forks since boot */
+	unsigned int running;               /* runnable tasks right now */
+	unsigned int blocked;               /* tasks waiting on I/O right now */
+} SchedCounters;
+
+int cpusample(CpuStat *cs, const char *buf);
+int schedcounters(const char *buf, SchedCounters *sc);
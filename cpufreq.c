@@ -0,0 +1,200 @@
+/* See LICENSE file for copyright and license details. */
+/* per-cpu frequency and throttle counts through held sysfs fds */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "cpufreq.h"
+
+#ifndef CPUDIR
+#define CPUDIR "/sys/devices/system/cpu"
+#endif
+
+#define PKGMAX 1024
+
+static int grow(CpuFreq *cf, int n);
+static int growpkg(CpuFreq *cf, int n);
+static int opencpu(int cpu, const char *file);
+static long long readfd(int fd);
+static void closecpu(CpuFreq *cf, int i);
+
+static int
+grow(CpuFreq *cf, int n)
+{
+	void *q;
+	int cap;
+
+	for (cap = cf->cap ? cf->cap : 64; cap < n; cap *= 2)
+		;
+	if (!(q = realloc(cf->curfd, cap * sizeof(*cf->curfd))))
+		return -1;
+	cf->curfd = q;
+	if (!(q = realloc(cf->corefd, cap * sizeof(*cf->corefd))))
+		return -1;
+	cf->corefd = q;
+	if (!(q = realloc(cf->pkg, cap * sizeof(*cf->pkg))))
+		return -1;
+	cf->pkg = q;
+	if (!(q = realloc(cf->opened, cap * sizeof(*cf->opened))))
+		return -1;
+	cf->opened = q;
+	if (!(q = realloc(cf->khz, cap * sizeof(*cf->khz))))
+		return -1;
+	cf->khz = q;
+	if (!(q = realloc(cf->maxkhz, cap * sizeof(*cf->maxkhz))))
+		return -1;
+	cf->maxkhz = q;
+	if (!(q = realloc(cf->throttles, cap * sizeof(*cf->throttles))))
+		return -1;
+	cf->throttles = q;
+	if (!(q = realloc(cf->throttled, cap * sizeof(*cf->throttled))))
+		return -1;
+	cf->throttled = q;
+	memset(cf->opened + cf->cap, 0, cap - cf->cap);
+	cf->cap = cap;
+	return 0;
+}
+
+static int
+growpkg(CpuFreq *cf, int n)
+{
+	void *q;
+	int cap, i;
+
+	for (cap = cf->pkgcap ? cf->pkgcap : 4; cap < n; cap *= 2)
+		;
+	if (!(q = realloc(cf->pkgcpu, cap * sizeof(*cf->pkgcpu))))
+		return -1;
+	cf->pkgcpu = q;
+	if (!(q = realloc(cf->pkgfd, cap * sizeof(*cf->pkgfd))))
+		return -1;
+	cf->pkgfd = q;
+	if (!(q = realloc(cf->pkgopened, cap * sizeof(*cf->pkgopened))))
+		return -1;
+	cf->pkgopened = q;
+	if (!(q = realloc(cf->pkgthrottles, cap * sizeof(*cf->pkgthrottles))))
+		return -1;
+	cf->pkgthrottles = q;
+	if (!(q = realloc(cf->pkgthrottled, cap * sizeof(*cf->pkgthrottled))))
+		return -1;
+	cf->pkgthrottled = q;
+	for (i = cf->pkgcap; i < cap; i++) {
+		cf->pkgcpu[i] = cf->pkgfd[i] = -1;
+		cf->pkgopened[i] = cf->pkgthrottled[i] = 0;
+		cf->pkgthrottles[i] = 0;
+	}
+	cf->pkgcap = cap;
+	return 0;
+}
+
+static int
+opencpu(int cpu, const char *file)
+{
+	char path[128];
+
+	snprintf(path, sizeof(path), CPUDIR "/cpu%d/%s", cpu, file);
+	return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+static long long
+readfd(int fd)
+{
+	char buf[32];
+	ssize_t len;
+
+	if (fd < 0 || (len = pread(fd, buf, sizeof(buf) - 1, 0)) <= 0)
+		return -1;
+	buf[len] = '\0';
+	return strtoll(buf, NULL, 10);
+}
+
+static void
+closecpu(CpuFreq *cf, int i)
+{
+	int p;
+
+	if (cf->curfd[i] >= 0)
+		close(cf->curfd[i]);
+	if (cf->corefd[i] >= 0)
+		close(cf->corefd[i]);
+	/* hand the package counter to the next of its cpus to come online */
+	if ((p = cf->pkg[i]) >= 0 && cf->pkgcpu[p] == i) {
+		if (cf->pkgfd[p] >= 0)
+			close(cf->pkgfd[p]);
+		cf->pkgcpu[p] = cf->pkgfd[p] = -1;
+		cf->pkgopened[p] = cf->pkgthrottled[p] = 0;
+	}
+	cf->opened[i] = 0;
+}
+
+/*
+ * One pread per held fd and cpu. The files of a cpu are opened the
+ * first time it is seen online and closed when it goes offline, since
+ * hotplug removes its cpufreq directory; a cpu without cpufreq or
+ * thermal_throttle simply keeps -1 there and costs nothing per tick.
+ * package_throttle_count reads the same counter through every cpu of
+ * a package, so only the first online cpu of each package holds it.
+ */
+int
+freqsample(CpuFreq *cf, int ncpu, const unsigned char *online)
+{
+	unsigned long long t;
+	long long v;
+	int i, p, fd;
+
+	if (ncpu > cf->cap && grow(cf, ncpu) < 0)
+		return -1;
+	cf->ncpu = ncpu;
+
+	for (i = 0; i < ncpu; i++) {
+		if (!online[i]) {
+			if (cf->opened[i])
+				closecpu(cf, i);
+			cf->khz[i] = 0;
+			cf->throttled[i] = 0;
+			continue;
+		}
+		if (!cf->opened[i]) {
+			cf->curfd[i] = opencpu(i, "cpufreq/scaling_cur_freq");
+			cf->corefd[i] = opencpu(i, "thermal_throttle/core_throttle_count");
+			fd = opencpu(i, "cpufreq/cpuinfo_max_freq");
+			cf->maxkhz[i] = (v = readfd(fd)) > 0 ? v : 0;
+			if (fd >= 0)
+				close(fd);
+			fd = opencpu(i, "topology/physical_package_id");
+			v = readfd(fd);
+			if (fd >= 0)
+				close(fd);
+			if (v >= 0 && v < PKGMAX && v >= cf->pkgcap && growpkg(cf, v + 1) < 0)
+				v = -1;
+			cf->pkg[i] = v >= 0 && v < PKGMAX ? v : -1;
+			if (cf->pkg[i] >= cf->npkg)
+				cf->npkg = cf->pkg[i] + 1;
+			cf->opened[i] = 1;
+		}
+		if ((p = cf->pkg[i]) >= 0 && cf->pkgcpu[p] < 0) {
+			cf->pkgcpu[p] = i;
+			cf->pkgfd[p] = opencpu(i, "thermal_throttle/package_throttle_count");
+		}
+
+		cf->khz[i] = (v = readfd(cf->curfd[i])) > 0 ? v : 0;
+		t = (v = readfd(cf->corefd[i])) > 0 ? v : 0;
+		/* the first sample after opening has nothing to compare against */
+		cf->throttled[i] = cf->opened[i] == 2 && t > cf->throttles[i];
+		cf->throttles[i] = t;
+		cf->opened[i] = 2;
+	}
+
+	for (p = 0; p < cf->npkg; p++) {
+		if (cf->pkgfd[p] < 0)
+			continue;
+		t = (v = readfd(cf->pkgfd[p])) > 0 ? v : 0;
+		cf->pkgthrottled[p] = cf->pkgopened[p] && t > cf->pkgthrottles[p];
+		cf->pkgthrottles[p] = t;
+		cf->pkgopened[p] = 1;
+	}
+	return 0;
+}
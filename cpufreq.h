@@ -0,0 +1,26 @@
+/* See LICENSE file for copyright and license details. */
+
+/* per-cpu frequency and thermal throttle counters, one array per field */
+typedef struct {
+	int ncpu;
+	int cap;
+	int *curfd;                         /* cpufreq/scaling_cur_freq, -1 if absent */
+	int *corefd;                        /* thermal_throttle/core_throttle_count */
+	int *pkg;                           /* topology/physical_package_id, -1 if unknown */
+	unsigned char *opened;              /* 0 closed, 1 opened, 2 sampled since */
+	unsigned int *khz;                  /* 0 when unknown */
+	unsigned int *maxkhz;               /* cpuinfo_max_freq, 0 when unknown */
+	unsigned long long *throttles;      /* core events since boot */
+	unsigned char *throttled;           /* throttles rose over the last interval */
+
+	/* the package counter is shared by all its cpus, read once through one of them */
+	int npkg;
+	int pkgcap;
+	int *pkgcpu;                        /* cpu holding pkgfd, -1 if none online */
+	int *pkgfd;                         /* thermal_throttle/package_throttle_count */
+	unsigned char *pkgopened;
+	unsigned long long *pkgthrottles;
+	unsigned char *pkgthrottled;
+} CpuFreq;
+
+int freqsample(CpuFreq *cf, int ncpu, const unsigned char *online);
@@ -0,0 +1,66 @@
+/* See LICENSE file for copyright and license details. */
+/* deadline min-heap driving the refresh loop */
+
+#include "deadline.h"
+
+int
+schedpush(Sched *s, int id, double deadline)
+{
+	SchedEntry e;
+	int i, parent;
+
+	if (s->n >= SCHEDMAX)
+		return -1;
+
+	e.deadline = deadline;
+	e.id = id;
+	for (i = s->n++; i > 0; i = parent) {
+		parent = (i - 1) / 2;
+		if (s->heap[parent].deadline <= deadline)
+			break;
+		s->heap[i] = s->heap[parent];
+	}
+	s->heap[i] = e;
+	return 0;
+}
+
+int
+schedpop(Sched *s, SchedEntry *e)
+{
+	SchedEntry last;
+	int i, child;
+
+	if (s->n == 0)
+		return -1;
+
+	*e = s->heap[0];
+	last = s->heap[--s->n];
+	for (i = 0; (child = 2 * i + 1) < s->n; i = child) {
+		if (child + 1 < s->n && s->heap[child + 1].deadline < s->heap[child].deadline)
+			child++;
+		if (last.deadline <= s->heap[child].deadline)
+			break;
+		s->heap[i] = s->heap[child];
+	}
+	s->heap[i] = last;
+	return 0;
+}
+
+/* earliest deadline, or a negative value when nothing is scheduled */
+double
+schednext(const Sched *s)
+{
+	return s->n ? s->heap[0].deadline : -1;
+}
+
+/* whether id already has a deadline queued */
+int
+schedhas(const Sched *s, int id)
+{
+	int i;
+
+	for (i = 0; i < s->n; i++)
+		if (s->heap[i].id == id)
+			return 1;
+	return 0;
+}
@@ -0,0 +1,19 @@
+/* See LICENSE file for copyright and license details. */
+
+#define SCHEDMAX 64
+
+typedef struct {
+	double deadline;
+	int id;
+} SchedEntry;
+
+/* binary min-heap of deadlines */
+typedef struct {
+	SchedEntry heap[SCHEDMAX];
+	int n;
+} Sched;
+
+int schedpush(Sched *s, int id, double deadline);
+int schedpop(Sched *s, SchedEntry *e);
+double schednext(const Sched *s);
+int schedhas(const Sched *s, int id);
@@ -0,0 +1,169 @@
+/* See LICENSE file for copyright and license details. */
+/* per-device I/O rates from /proc/diskstats */
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "disk.h"
+#include "hash.h"
+
+static DiskDev *lookup(DiskTable *t, unsigned int dev, const char *name, size_t len);
+static double rate(const void *d);
+static void update(DiskTable *t, DiskDev *d, const unsigned long long *f);
+
+/* find the slot for dev, claiming a free one if it is new */
+static DiskDev *
+lookup(DiskTable *t, unsigned int dev, const char *name, size_t len)
+{
+	DiskDev *d;
+	char path[64];
+
+	d = &t->slots[hashfind(t->slots, sizeof(*d), DISKMAX, dev)];
+	if (d->dev)
+		return d;
+	if (t->n >= DISKMAX / 4 * 3)
+		return NULL;
+	t->n++;
+	memset(d, 0, sizeof(*d));
+	d->dev = dev;
+	if (len >= sizeof(d->name))
+		len = sizeof(d->name) - 1;
+	memcpy(d->name, name, len);
+
+	/* classified once, when the device first shows up */
+	snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/partition", dev >> 20, dev & 0xfffff);
+	if (access(path, F_OK) == 0)
+		d->kind = DiskPartition;
+	else if (!strncmp(d->name, "dm-", 3))
+		d->kind = DiskMapper;
+	return d;
+}
+
+static double
+rate(const void *d)
+{
+	return ((const DiskDev *)d)->rbps + ((const DiskDev *)d)->wbps;
+}
+
+/* f: reads, merged, sectors, ms, the same four for writes, in flight, io ms */
+static void
+update(DiskTable *t, DiskDev *d, const unsigned long long *f)
+{
+	unsigned long long dr, dw;
+
+	/* a new device or counters that went backwards start over */
+	d->valid = d->gen && t->dt > 0 &&
+	           f[0] >= d->reads && f[4] >= d->writes &&
+	           f[2] >= d->rsectors && f[6] >= d->wsectors &&
+	           f[3] >= d->rticks && f[7] >= d->wticks && f[9] >= d->ioticks;
+	if (d->valid) {
+		dr = f[0] - d->reads;
+		dw = f[4] - d->writes;
+		d->riops = dr / t->dt;
+		d->wiops = dw / t->dt;
+		d->rbps = (f[2] - d->rsectors) * 512 / t->dt;
+		d->wbps = (f[6] - d->wsectors) * 512 / t->dt;
+		d->await = dr + dw ? (double)(f[3] - d->rticks + f[7] - d->wticks) / (dr + dw) : 0;
+		d->util = (f[9] - d->ioticks) / (t->dt * 10);
+		if (d->util > 100)
+			d->util = 100;
+	} else {
+		d->riops = d->wiops = d->rbps = d->wbps = d->await = d->util = 0;
+	}
+
+	d->reads = f[0];
+	d->writes = f[4];
+	d->rsectors = f[2];
+	d->wsectors = f[6];
+	d->rticks = f[3];
+	d->wticks = f[7];
+	d->ioticks = f[9];
+	d->gen = t->gen;
+}
+
+/*
+ * One pass over the buffer: each line is "major minor name" followed by
+ * at least ten counters. Numbers are accumulated in place and the name
+ * is only copied when a device is first seen, so nothing is allocated.
+ */
+int
+disksample(DiskTable *t, const char *buf, double now)
+{
+	const char *p, *name;
+	unsigned long long f[10], v;
+	unsigned int major, minor, i;
+	size_t len;
+	int n;
+	DiskDev *d;
+
+	t->dt = t->last > 0 ? now - t->last : 0;
+	t->last = now;
+	if (++t->gen == 0)
+		t->gen = 1;
+
+	for (p = buf; *p;) {
+		for (major = 0; *p == ' '; p++)
+			;
+		for (; (unsigned)(*p - '0') < 10; p++)
+			major = major * 10 + (*p - '0');
+		for (minor = 0; *p == ' '; p++)
+			;
+		for (; (unsigned)(*p - '0') < 10; p++)
+			minor = minor * 10 + (*p - '0');
+		for (; *p == ' '; p++)
+			;
+		for (name = p; *p && *p != ' ' && *p != '\n'; p++)
+			;
+		len = p - name;
+
+		for (n = 0; n < 10 && *p == ' '; n++) {
+			for (; *p == ' '; p++)
+				;
+			for (v = 0; (unsigned)(*p - '0') < 10; p++)
+				v = v * 10 + (*p - '0');
+			f[n] = v;
+		}
+		while (*p && *p != '\n')
+			p++;
+		if (*p)
+			p++;
+
+		if (n < 10 || len == 0 || minor > 0xfffff || (major == 0 && minor == 0))
+			continue;
+		if ((d = lookup(t, major << 20 | minor, name, len)))
+			update(t, d, f);
+	}
+
+	/* devices that were not listed this time are gone */
+	for (i = 0; i < DISKMAX;) {
+		if (t->slots[i].dev && t->slots[i].gen != t->gen) {
+			hashdel(t->slots, sizeof(t->slots[0]), DISKMAX, i); /* may shift another entry into i */
+			t->n--;
+		} else {
+			i++;
+		}
+	}
+	return t->n;
+}
+
+/*
+ * The n busiest devices by bytes/s, busiest first. Partitions and
+ * device-mapper targets are only included when their bit is in kinds;
+ * devices that have never completed a request are left out.
+ */
+int
+disktop(const DiskTable *t, DiskDev *top, int n, int kinds)
+{
+	const DiskDev *d;
+	int i, count;
+
+	count = 0;
+	for (i = 0; i < DISKMAX; i++) {
+		d = &t->slots[i];
+		if (!d->dev || (d->kind && !(d->kind & kinds)) || d->reads + d->writes == 0)
+			continue;
+		count = topinsert(top, sizeof(*top), count, n, d, rate);
+	}
+	return count;
+}
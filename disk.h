@@ -0,0 +1,31 @@
+/* See LICENSE file for copyright and license details. */
+
+#define DISKMAX  4096 /* power of two, kept at most 3/4 full */
+#define DISKNAME 32
+
+enum { DiskPartition = 1, DiskMapper = 2 };
+
+typedef struct {
+	unsigned int dev;        /* major << 20 | minor, 0 marks a free slot */
+	unsigned int gen;        /* last sample the device was seen in */
+	int valid;               /* rates cover a full interval */
+	int kind;                /* DiskPartition, DiskMapper */
+	char name[DISKNAME];
+	unsigned long long reads, writes, rsectors, wsectors;
+	unsigned long long rticks, wticks, ioticks;
+	double riops, wiops, rbps, wbps;
+	double await;            /* ms per completed request */
+	double util;             /* percent of the interval with I/O in flight */
+} DiskDev;
+
+/* open-addressed table of block devices keyed by device number */
+typedef struct {
+	DiskDev slots[DISKMAX];
+	int n;
+	unsigned int gen;
+	double last;
+	double dt;
+} DiskTable;
+
+int disksample(DiskTable *t, const char *buf, double now);
+int disktop(const DiskTable *t, DiskDev *top, int n, int kinds);
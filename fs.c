@@ -0,0 +1,267 @@
+/* See LICENSE file for copyright and license details. */
+/* mount table from mountinfo and capacity from timeout-guarded statvfs */
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/statvfs.h>
+#include <time.h>
+
+#include "fs.h"
+
+struct FsJob {
+	int refs;                /* the worker and the mount, under lock */
+	int done;
+	int ret;
+	struct statvfs st;
+	char path[FSPATHLEN];
+};
+
+static const char *field(const char *p, char *dst, size_t size);
+static int isvirtual(const char *type);
+static void release(FsJob *j);
+static void *statworker(void *arg);
+static void startjob(FsMount *m, pthread_attr_t *attr);
+
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t cond;
+static int condinit;
+static FsMount fresh[FSMAX];
+
+/* pseudo and image filesystems that only add noise to a capacity view */
+static const char *virtualfs[] = {
+	"autofs", "binfmt_misc", "bpf", "cgroup", "cgroup2", "configfs",
+	"debugfs", "devpts", "devtmpfs", "efivarfs", "fusectl", "hugetlbfs",
+	"mqueue", "nsfs", "proc", "pstore", "ramfs", "rpc_pipefs",
+	"securityfs", "squashfs", "sysfs", "tmpfs", "tracefs",
+	"fuse.gvfsd-fuse", "fuse.portal",
+};
+
+/* copy one space-separated field, undoing the \ooo escapes */
+static const char *
+field(const char *p, char *dst, size_t size)
+{
+	size_t n;
+
+	for (n = 0; *p && *p != ' ' && *p != '\n'; p++) {
+		if (*p == '\\' && (unsigned)(p[1] - '0') < 8 &&
+		    (unsigned)(p[2] - '0') < 8 && (unsigned)(p[3] - '0') < 8) {
+			if (n + 1 < size)
+				dst[n++] = (p[1] - '0') << 6 | (p[2] - '0') << 3 | (p[3] - '0');
+			p += 3;
+		} else if (n + 1 < size) {
+			dst[n++] = *p;
+		}
+	}
+	dst[n] = '\0';
+	return *p == ' ' ? p + 1 : p;
+}
+
+static int
+isvirtual(const char *type)
+{
+	size_t i;
+
+	for (i = 0; i < sizeof(virtualfs) / sizeof(virtualfs[0]); i++)
+		if (!strcmp(type, virtualfs[i]))
+			return 1;
+	return 0;
+}
+
+/* call with lock held */
+static void
+release(FsJob *j)
+{
+	if (--j->refs == 0)
+		free(j);
+}
+
+static void *
+statworker(void *arg)
+{
+	FsJob *j = arg;
+	struct statvfs st;
+	int ret;
+
+	ret = statvfs(j->path, &st);
+	pthread_mutex_lock(&lock);
+	j->st = st;
+	j->ret = ret;
+	j->done = 1;
+	pthread_cond_broadcast(&cond);
+	release(j);
+	pthread_mutex_unlock(&lock);
+	return NULL;
+}
+
+/* call with lock held */
+static void
+startjob(FsMount *m, pthread_attr_t *attr)
+{
+	pthread_t tid;
+	FsJob *j;
+
+	if (!(j = calloc(1, sizeof(*j))))
+		return;
+	memcpy(j->path, m->path, sizeof(j->path));
+	j->refs = 2;
+	if (pthread_create(&tid, attr, statworker, j) != 0) {
+		free(j);
+		return;
+	}
+	m->job = j;
+}
+
+/*
+ * Rebuild the table from a mountinfo buffer. Only real filesystems are
+ * kept, and only the first mount of each device so bind mounts do not
+ * repeat. Mounts that survive keep their last numbers and any statvfs
+ * still in flight.
+ */
+int
+fsparse(FsTable *t, const char *buf)
+{
+	FsMount *m;
+	const char *p;
+	char tok[FSPATHLEN], path[FSPATHLEN], type[32];
+	unsigned int major, minor;
+	int i, j, n, id;
+
+	n = 0;
+	for (p = buf; *p && n < FSMAX;) {
+		/* id parent major:minor root mountpoint options [optional...] - type source superoptions */
+		p = field(p, tok, sizeof(tok));
+		id = atoi(tok);
+		p = field(p, tok, sizeof(tok));
+		p = field(p, tok, sizeof(tok));
+		major = minor = 0;
+		sscanf(tok, "%u:%u", &major, &minor);
+		p = field(p, tok, sizeof(tok));
+		p = field(p, path, sizeof(path));
+		do
+			p = field(p, tok, sizeof(tok));
+		while (*p && *p != '\n' && strcmp(tok, "-"));
+		p = field(p, type, sizeof(type));
+		while (*p && *p++ != '\n')
+			;
+
+		if (!path[0] || isvirtual(type))
+			continue;
+		m = &fresh[n];
+		memset(m, 0, sizeof(*m));
+		m->id = id;
+		m->dev = major << 20 | (minor & 0xfffff);
+		memcpy(m->path, path, sizeof(m->path));
+		memcpy(m->type, type, sizeof(m->type));
+		for (i = 0; i < n; i++)
+			if (fresh[i].dev == m->dev)
+				break;
+		if (i == n)
+			n++;
+	}
+
+	pthread_mutex_lock(&lock);
+	for (i = 0; i < t->n; i++) {
+		for (j = 0; j < n; j++) {
+			if (fresh[j].id == t->mounts[i].id && !strcmp(fresh[j].path, t->mounts[i].path)) {
+				fresh[j].valid = t->mounts[i].valid;
+				fresh[j].hung = t->mounts[i].hung;
+				fresh[j].size = t->mounts[i].size;
+				fresh[j].used = t->mounts[i].used;
+				fresh[j].avail = t->mounts[i].avail;
+				fresh[j].job = t->mounts[i].job;
+				break;
+			}
+		}
+		if (j == n && t->mounts[i].job)
+			release(t->mounts[i].job);
+	}
+	pthread_mutex_unlock(&lock);
+
+	memcpy(t->mounts, fresh, n * sizeof(fresh[0]));
+	t->n = n;
+	return n;
+}
+
+/*
+ * statvfs every mount on its own detached thread and wait at most
+ * timeout seconds for all of them. A mount whose call does not return
+ * is marked hung and skipped until that call finally completes, so a
+ * dead NFS server costs one stuck thread, never a stuck collector.
+ * Only the calls started here are waited for; one still stuck from an
+ * earlier round would otherwise cost the full timeout every round.
+ */
+void
+fsstat(FsTable *t, double timeout)
+{
+	pthread_condattr_t ca;
+	pthread_attr_t attr;
+	struct timespec ts;
+	FsMount *m;
+	FsJob *j;
+	unsigned char started[FSMAX];
+	int i, pending;
+
+	if (!condinit) {
+		pthread_condattr_init(&ca);
+		pthread_condattr_setclock(&ca, CLOCK_MONOTONIC);
+		pthread_cond_init(&cond, &ca);
+		pthread_condattr_destroy(&ca);
+		condinit = 1;
+	}
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	pthread_attr_setstacksize(&attr, 64 * 1024);
+
+	pthread_mutex_lock(&lock);
+	for (i = 0; i < t->n; i++) {
+		m = &t->mounts[i];
+		started[i] = 0;
+		if (m->job && !m->job->done)
+			continue;
+		if (m->job) {
+			release(m->job);
+			m->job = NULL;
+		}
+		startjob(m, &attr);
+		started[i] = m->job != NULL;
+	}
+	pthread_attr_destroy(&attr);
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	ts.tv_sec += (time_t)timeout;
+	ts.tv_nsec += (long)((timeout - (time_t)timeout) * 1e9);
+	if (ts.tv_nsec >= 1000000000L) {
+		ts.tv_sec++;
+		ts.tv_nsec -= 1000000000L;
+	}
+	for (;;) {
+		for (i = pending = 0; i < t->n; i++)
+			if (started[i] && !t->mounts[i].job->done)
+				pending = 1;
+		if (!pending || pthread_cond_timedwait(&cond, &lock, &ts) == ETIMEDOUT)
+			break;
+	}
+
+	for (i = 0; i < t->n; i++) {
+		m = &t->mounts[i];
+		if (!(j = m->job))
+			continue;
+		if (!j->done) {
+			m->hung = 1;
+			continue;
+		}
+		m->hung = 0;
+		if (j->ret == 0) {
+			m->size = (unsigned long long)j->st.f_blocks * j->st.f_frsize;
+			m->avail = (unsigned long long)j->st.f_bavail * j->st.f_frsize;
+			m->used = m->size - (unsigned long long)j->st.f_bfree * j->st.f_frsize;
+			m->valid = 1;
+		}
+		release(j);
+		m->job = NULL;
+	}
+	pthread_mutex_unlock(&lock);
+}
@@ -0,0 +1,25 @@
+/* See LICENSE file for copyright and license details. */
+
+#define FSMAX     128
+#define FSPATHLEN 256
+
+typedef struct FsJob FsJob;
+
+typedef struct {
+	int id;                  /* mount id from mountinfo */
+	unsigned int dev;        /* major << 20 | minor */
+	int valid;               /* statvfs has returned at least once */
+	int hung;                /* the last statvfs did not return in time */
+	char path[FSPATHLEN];
+	char type[32];
+	unsigned long long size, used, avail; /* bytes */
+	FsJob *job;              /* statvfs still in flight */
+} FsMount;
+
+typedef struct {
+	FsMount mounts[FSMAX];
+	int n;
+} FsTable;
+
+int fsparse(FsTable *t, const char *buf);
+void fsstat(FsTable *t, double timeout);
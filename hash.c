@@ -0,0 +1,65 @@
+/* See LICENSE file for copyright and license details. */
+/* open-addressed slot tables and top-n selection shared by the samplers */
+
+#include <string.h>
+
+#include "hash.h"
+
+#define ELEM(slots, size, i) ((char *)(slots) + (size_t)(i) * (size))
+#define KEY(slots, size, i)  (*(const unsigned int *)ELEM(slots, size, i))
+
+/* the slot holding key, or the free slot where it belongs */
+unsigned int
+hashfind(const void *slots, size_t size, unsigned int nslots, unsigned int key)
+{
+	unsigned int i;
+
+	for (i = HASHSLOT(key, nslots); KEY(slots, size, i); i = (i + 1) & (nslots - 1))
+		if (KEY(slots, size, i) == key)
+			break;
+	return i;
+}
+
+/* backward-shift deletion keeps probe chains intact without tombstones */
+void
+hashdel(void *slots, size_t size, unsigned int nslots, unsigned int i)
+{
+	unsigned int j, home;
+
+	for (j = i;;) {
+		memset(ELEM(slots, size, i), 0, sizeof(unsigned int));
+		for (;;) {
+			j = (j + 1) & (nslots - 1);
+			if (!KEY(slots, size, j))
+				return;
+			home = HASHSLOT(KEY(slots, size, j), nslots);
+			if (i <= j ? (i >= home || home > j) : (i >= home && home > j))
+				break;
+		}
+		memcpy(ELEM(slots, size, i), ELEM(slots, size, j), size);
+		i = j;
+	}
+}
+
+/*
+ * Insert e into top, which holds the count highest scoring elements so
+ * far, best first, and at most n of them; returns the new count.
+ */
+int
+topinsert(void *top, size_t size, int count, int n, const void *e,
+          double (*score)(const void *))
+{
+	double v;
+	int j;
+
+	v = score(e);
+	for (j = count; j > 0 && score(ELEM(top, size, j - 1)) < v; j--)
+		if (j < n)
+			memcpy(ELEM(top, size, j), ELEM(top, size, j - 1), size);
+	if (j < n) {
+		memcpy(ELEM(top, size, j), e, size);
+		if (count < n)
+			count++;
+	}
+	return count;
+}
@@ -0,0 +1,15 @@
+/* See LICENSE file for copyright and license details. */
+
+#include <stddef.h>
+
+/*
+ * Open-addressed slots for the tables keyed by a small number: each
+ * element starts with its unsigned int key, 0 marking a free slot, and
+ * the slot count is a power of two kept at most 3/4 full.
+ */
+#define HASHSLOT(key, nslots) (((unsigned int)(key) * 2654435761u) & ((nslots) - 1))
+
+unsigned int hashfind(const void *slots, size_t size, unsigned int nslots, unsigned int key);
+void hashdel(void *slots, size_t size, unsigned int nslots, unsigned int i);
+int topinsert(void *top, size_t size, int count, int n, const void *e,
+              double (*score)(const void *));
@@ -0,0 +1,222 @@
+/* See LICENSE file for copyright and license details. */
+/* /proc/interrupts and /proc/softirqs counter matrices */
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "irq.h"
+
+#define ISDIGIT(c) ((unsigned)((c) - '0') < 10)
+
+static int grow(IrqTable *t, int rows, int cols);
+static const char *skipspaces(const char *p, const char *end);
+static void setdesc(IrqRow *r, const char *p, const char *eol);
+static unsigned long long delta(unsigned long long cur, unsigned long long prev);
+
+/* a change of columns moves every counter, so nothing can be diffed */
+static int
+grow(IrqTable *t, int rows, int cols)
+{
+	void *q;
+	size_t n;
+	int rowcap, colcap, i;
+
+	for (rowcap = t->rowcap ? t->rowcap : 64; rowcap < rows; rowcap *= 2)
+		;
+	for (colcap = t->colcap ? t->colcap : 8; colcap < cols; colcap *= 2)
+		;
+	n = (size_t)rowcap * colcap;
+	if (!(q = realloc(t->cur, n * sizeof(*t->cur))))
+		return -1;
+	t->cur = q;
+	if (!(q = realloc(t->prev, n * sizeof(*t->prev))))
+		return -1;
+	t->prev = q;
+	if (!(q = realloc(t->rates, n * sizeof(*t->rates))))
+		return -1;
+	t->rates = q;
+	if (!(q = realloc(t->rows, rowcap * sizeof(*t->rows))))
+		return -1;
+	t->rows = q;
+	if (!(q = realloc(t->cpu, colcap * sizeof(*t->cpu))))
+		return -1;
+	t->cpu = q;
+	if (!(q = realloc(t->cpurate, colcap * sizeof(*t->cpurate))))
+		return -1;
+	t->cpurate = q;
+
+	if (colcap != t->colcap)
+		for (i = 0; i < t->rowcap; i++)
+			t->rows[i].fresh = 1;
+	for (i = t->rowcap; i < rowcap; i++) {
+		t->rows[i].name[0] = '\0';
+		t->rows[i].fresh = 1;
+	}
+	t->rowcap = rowcap;
+	t->colcap = colcap;
+	return 0;
+}
+
+/*
+ * Counters are right-aligned in 10-wide columns, so on a mostly idle
+ * many-cpu host a row is mostly spaces; step over them eight at a time.
+ */
+static const char *
+skipspaces(const char *p, const char *end)
+{
+	uint64_t w;
+
+	while (end - p >= 8) {
+		memcpy(&w, p, 8);
+		if (w != 0x2020202020202020ULL)
+			break;
+		p += 8;
+	}
+	while (p < end && *p == ' ')
+		p++;
+	return p;
+}
+
+/*
+ * What follows the counters: the device is the last word for a
+ * numbered interrupt ("IR-PCI-MSI 524288-edge eth0"), the whole text
+ * with its padding squeezed out for the named ones.
+ */
+static void
+setdesc(IrqRow *r, const char *p, const char *eol)
+{
+	const char *s;
+	size_t n;
+
+	while (eol > p && eol[-1] == ' ')
+		eol--;
+	if (ISDIGIT(r->name[0])) {
+		for (s = eol; s > p && s[-1] != ' '; s--)
+			;
+		n = eol - s < IRQDESCLEN ? (size_t)(eol - s) : IRQDESCLEN - 1;
+		memcpy(r->desc, s, n);
+		r->desc[n] = '\0';
+		return;
+	}
+	for (n = 0; p < eol && n < IRQDESCLEN - 1; p++)
+		if (*p != ' ' || (n > 0 && r->desc[n - 1] != ' '))
+			r->desc[n++] = *p;
+	r->desc[n] = '\0';
+}
+
+/* the kernel keeps most of these counters in 32 bits, so they wrap */
+static unsigned long long
+delta(unsigned long long cur, unsigned long long prev)
+{
+	if (cur >= prev)
+		return cur - prev;
+	if (prev <= 0xffffffffULL)
+		return (cur - prev) & 0xffffffffULL;
+	return 0;
+}
+
+/*
+ * One pass over the buffer. A row whose name moved, as when a driver
+ * allocates vectors, and every row after a change of the cpu columns
+ * from hotplug, start over and report no rate for this interval.
+ */
+int
+irqparse(IrqTable *t, const char *buf, size_t len, double now)
+{
+	const char *p, *end, *eol, *label;
+	unsigned long long v, *cur;
+	double dt, *rate;
+	IrqRow *r;
+	size_t n;
+	int i, c, id, ncols, changed;
+
+	end = buf + len;
+	if (!(eol = memchr(buf, '\n', len)))
+		return -1;
+
+	/* the header names the cpu of each column */
+	changed = 0;
+	ncols = 0;
+	for (p = skipspaces(buf, eol); p < eol; p = skipspaces(p, eol)) {
+		if (strncmp(p, "CPU", 3) != 0)
+			return -1;
+		for (p += 3, id = 0; ISDIGIT(*p); p++)
+			id = id * 10 + (*p - '0');
+		if (ncols >= t->colcap && grow(t, t->rowcap, ncols + 1) < 0)
+			return -1;
+		if (ncols >= t->ncols || t->cpu[ncols] != id)
+			changed = 1;
+		t->cpu[ncols++] = id;
+	}
+	if (ncols != t->ncols)
+		changed = 1;
+	t->ncols = ncols;
+
+	for (i = 0, p = eol + 1; p < end; i++, p = eol + 1) {
+		if (!(eol = memchr(p, '\n', end - p)))
+			eol = end;
+		label = p = skipspaces(p, eol);
+		while (p < eol && *p != ':')
+			p++;
+		if (p == eol) {
+			i--;
+			continue;
+		}
+		if (i >= t->rowcap && grow(t, i + 1, t->colcap) < 0)
+			return -1;
+		r = &t->rows[i];
+		n = p - label < IRQNAMELEN ? (size_t)(p - label) : IRQNAMELEN - 1;
+		if (changed || strncmp(r->name, label, n) != 0 || r->name[n] != '\0') {
+			memcpy(r->name, label, n);
+			r->name[n] = '\0';
+			r->fresh = 1;
+		}
+
+		/* ERR and MIS have a single column, so stop at the first non-digit */
+		cur = t->cur + (size_t)i * t->colcap;
+		for (p++, c = 0; c < ncols; c++) {
+			p = skipspaces(p, eol);
+			for (v = 0; p < eol && ISDIGIT(*p); p++)
+				v = v * 10 + (*p - '0');
+			cur[c] = v;
+		}
+		setdesc(r, p, eol);
+	}
+	t->nrows = i;
+
+	dt = t->last > 0 ? now - t->last : 0;
+	t->last = now;
+	memset(t->cpurate, 0, ncols * sizeof(*t->cpurate));
+	for (i = 0; i < t->nrows; i++) {
+		r = &t->rows[i];
+		cur = t->cur + (size_t)i * t->colcap;
+		rate = t->rates + (size_t)i * t->colcap;
+		r->rate = 0;
+		for (c = 0; c < ncols; c++) {
+			rate[c] = r->fresh || dt <= 0 ? 0 : delta(cur[c], t->prev[(size_t)i * t->colcap + c]) / dt;
+			r->rate += rate[c];
+			t->cpurate[c] += rate[c];
+		}
+		memcpy(t->prev + (size_t)i * t->colcap, cur, ncols * sizeof(*cur));
+		r->fresh = 0;
+	}
+	return t->nrows;
+}
+
+/* indices of the n busiest rows, busiest first */
+int
+irqtop(const IrqTable *t, int *top, int n)
+{
+	int i, j, count;
+
+	count = 0;
+	for (i = 0; i < t->nrows && n > 0; i++) {
+		if (count == n && t->rows[i].rate <= t->rows[top[n - 1]].rate)
+			continue;
+		for (j = count < n ? count++ : n - 1; j > 0 && t->rows[top[j - 1]].rate < t->rows[i].rate; j--)
+			top[j] = top[j - 1];
+		top[j] = i;
+	}
+	return count;
+}
@@ -0,0 +1,30 @@
+/* See LICENSE file for copyright and license details. */
+
+#define IRQNAMELEN 16
+#define IRQDESCLEN 32
+
+typedef struct {
+	char name[IRQNAMELEN];      /* "24", "NMI", "NET_RX" */
+	char desc[IRQDESCLEN];      /* device or description, "" for softirqs */
+	int fresh;                  /* nothing to diff against yet */
+	double rate;                /* per second over all cpus */
+} IrqRow;
+
+/*
+ * /proc/interrupts or /proc/softirqs as a row-major counter matrix,
+ * one row per line and one column per cpu in the header.
+ */
+typedef struct {
+	int nrows, ncols;
+	int rowcap, colcap;         /* colcap is the row stride */
+	int *cpu;                   /* cpu number of each column */
+	IrqRow *rows;
+	unsigned long long *cur;
+	unsigned long long *prev;
+	double *rates;              /* per row and column, per second */
+	double *cpurate;            /* per column, summed over the rows */
+	double last;
+} IrqTable;
+
+int irqparse(IrqTable *t, const char *buf, size_t len, double now);
+int irqtop(const IrqTable *t, int *top, int n);
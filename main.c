@@ -3,15 +3,19 @@
 
 #define _POSIX_C_SOURCE 200809L
 
-#include <ifaddrs.h>
+#include <errno.h>
+#include <limits.h>
+#include <fcntl.h>
 #include <locale.h>
+#include <poll.h>
+#include <pthread.h>
 #include <sys/socket.h>
 #include <sys/types.h>
 #include <netinet/in.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <sys/statvfs.h>
+#include <sys/resource.h>
 #include <sys/sysinfo.h>
 #include <sys/time.h>
 #include <time.h>
@@ -27,14 +31,77 @@
 #include "termbox2.h"
 
 #include "config.h"
+#include "battery.h"
+#include "cgroup.h"
+#include "cpu.h"
+#include "cpufreq.h"
+#include "deadline.h"
+#include "disk.h"
+#include "fs.h"
+#include "irq.h"
+#include "mem.h"
+#include "netdev.h"
+#include "netlink.h"
+#include "node.h"
+#include "proc.h"
+#include "procfile.h"
+#include "psi.h"
+#include "sensors.h"
+#include "watch.h"
 
 #define MAXSTRLEN 256
+#define MAXCPUS   1024
+#define MAXIFACES 16
+#define MAXDISKS  16
+#define MAXFS     16
+#define MAXPROCS  32
+#define MAXSENSORS 32
+#define MAXCGROUPS 32
+#define MAXIRQROWS 16
+#define MAXIRQCOLS 256
+#define MAXCOLLECTORS 32
+#define LENGTH(X) (sizeof (X) / sizeof (X)[0])
+
+/* ui loop poll slots */
+enum { FdTty, FdResize, FdNotify, FdLast };
+/* collector loop poll slots, one PSI trigger per resource */
+enum { CFdNetlink, CFdWatch, CFdMounts, CFdPsi, CFdLast = CFdPsi + PsiLast };
 
 /* Types */
+/* what one collector costs the collector thread */
+typedef struct {
+	unsigned int runs;
+	float lastms;
+	float avgms;             /* moving average over the last ~10 runs */
+} CollCost;
+
+/* one heatmap row: an interrupt or softirq and its rate per cpu column */
+typedef struct {
+	char name[IRQNAMELEN];
+	char desc[IRQDESCLEN];
+	int soft;
+	double rate;             /* per second over all cpus */
+	float cells[MAXIRQCOLS]; /* per second, per column */
+} IrqHeat;
+
+/* facts about the host that do not change per frame, see gethostfacts() */
+typedef struct {
+	char user[64];
+	char hostname[64];
+	char sysname[65];
+	char release[65];
+	char machine[65];
+} HostFacts;
+
 typedef struct {
 	char timestr[MAXSTRLEN];
 	char uptimestr[MAXSTRLEN];
 	char memorystr[MAXSTRLEN];
+	MemInfo meminfo;          /* kB, see mem.h */
+	double swapinps, swapoutps; /* bytes per second */
+	double zswapinps, zswapoutps; /* bytes per second loaded from and stored to zswap */
+	int haszram;
+	ZramStat zram;
 	char cpustr[MAXSTRLEN];
 	char networkstr[MAXSTRLEN];
 	char batterystr[MAXSTRLEN];
@@ -43,27 +110,141 @@ typedef struct {
 	char ipstr[MAXSTRLEN];
 	char gatewaystr[MAXSTRLEN];
 	char dnsstr[MAXSTRLEN];
+	HostFacts host;
+	int ncores;
+	float cputimes[CpuLast]; /* percent of online cpu time per field */
+	float corebusy[MAXCPUS]; /* percent, negative while offline */
+	float corefreq[MAXCPUS]; /* fraction of the core's max, negative when unknown */
+	unsigned char corethrottled[MAXCPUS];
+	int hasfreq;
+	float freqavg, freqmin, freqmax; /* GHz over online cores */
+	int nthrottled;          /* cores throttled over the last interval */
+	int npkgthrottled;       /* packages throttled over the last interval */
+	unsigned long long throttles, pkgthrottles;
+	double load[3];
+	int lrunnable, lentities; /* from /proc/loadavg */
+	SchedCounters sched;
+	double ctxtps, forkps;
+	int nifaces;
+	NetDev ifaces[MAXIFACES]; /* busiest links first */
+	int ndisks;
+	DiskDev disks[MAXDISKS];  /* busiest devices first */
+	int nfs;
+	FsMount fs[MAXFS];        /* in mount order */
+	Pressure pressure[PsiLast];
+	int stalled[PsiLast];     /* a PSI trigger fired within the last window */
+	int ntasks, nrunning;
+	int nprocs;
+	Proc topcpu[MAXPROCS];    /* busiest first */
+	Proc toprss[MAXPROCS];    /* largest first */
+	int nsensors;
+	Sensor sensors[MAXSENSORS]; /* temperatures first */
+	CollCost cost[MAXCOLLECTORS]; /* indexed like collectors */
+	double selfcpu;          /* percent of one cpu used by this process */
+	unsigned long long selfrss;
+	CgUsage cg;              /* own cgroup v2, invalid on v1 hosts */
+	int nnodes;
+	Node nodes[NODEMAX];
+	float nodebusy[NODEMAX];  /* percent over the node's online cores, negative when unknown */
+	int nirqs;
+	IrqHeat irqs[MAXIRQROWS]; /* busiest interrupts, then busiest softirqs */
+	int irqcols, irqspan;     /* heatmap columns, cpus folded into each */
+	int irqfirst, irqlast;    /* cpu numbers of the first and last column */
+	double irqtotal, softtotal;
+	int irqbusiest;           /* cpu taking the most hard interrupts */
+	double irqbusiestrate;
+	int ncgroups, cgtotal;
+	CgStat cgroups[MAXCGROUPS]; /* heaviest by cgroup_sort first */
 } SysInfo;
 
+typedef struct {
+	int x, y, w, h;
+} Rect;
+
+typedef struct {
+	const char *name;
+	void (*fn)(SysInfo *info);
+	const double *period; /* seconds, 0 when only run on change */
+	const int *evfd;      /* reports those changes; polled while it is -1 */
+} Collector;
+
 
 /* Function declarations */
 static void usage(void);
 static void die(const char *msg);
 static void printcenteredin(const char *str, int x, int y, int width, uint16_t fg, uint16_t bg);
 static void printat(const char *str, int x, int y, uint16_t fg, uint16_t bg);
+static char *nextline(char *s);
 static void getcurrenttime(char *buffer);
 static void getuptime(char *buffer);
-static void getmemoryinfo(char *buffer);
-static void getcpuusage(char *buffer);
-static void getnetworkstatus(char *buffer);
+static void getmemoryinfo(SysInfo *info);
+static void getvmstat(SysInfo *info);
+static void getcpuusage(SysInfo *info);
+static void getcores(SysInfo *info, const char *stat);
+static void getload(SysInfo *info, const char *stat);
 static void getbatterystatus(char *buffer);
-static void getvpnstatus(char *buffer);
-static void getipaddress(char *buffer);
-static void getgateway(char *buffer);
+static void getnetinfo(SysInfo *info);
 static void getdns(char *buffer);
+static void collecttime(SysInfo *info);
+static void collectuptime(SysInfo *info);
+static void collectmemory(SysInfo *info);
+static void collectcpu(SysInfo *info);
+static void collectbattery(SysInfo *info);
+static void collectnetdev(SysInfo *info);
+static void collectdisk(SysInfo *info);
+static void collectfs(SysInfo *info);
+static void collectpsi(SysInfo *info);
+static void collectprocs(SysInfo *info);
+static void collectsensors(SysInfo *info);
+static void collectfreq(SysInfo *info);
+static void collectself(SysInfo *info);
+static void collectcgroup(SysInfo *info);
+static void collectcgtree(SysInfo *info);
+static void collectnodes(SysInfo *info);
+static void addirqrows(SysInfo *info, const IrqTable *t, const IrqTable *cols, int n, int soft);
+static void collectirqs(SysInfo *info);
+static void runcollector(int id, SysInfo *info);
+static void collectsystem(SysInfo *info);
+static void collectdns(SysInfo *info);
+static void gethostfacts(HostFacts *hf);
+static void collecthost(SysInfo *info);
 static void collectsysteminfo(SysInfo *info);
+static double now(void);
+static void publish(const SysInfo *info);
+static void snapshot(SysInfo *info);
+static void *collectorloop(void *arg);
 static void displayinfo(const SysInfo *info);
+static int handleevent(const struct tb_event *ev, const SysInfo *info);
 static void drawbox(int x, int y, int width, int height, const char *title, uint16_t fg, uint16_t bg);
+static void layoutpanels(int width, int height, int hex_width);
+static int placepanel(const SysInfo *info, int (*height)(const SysInfo *, int), Rect *r);
+static int corecols(int width);
+static int coresheight(const SysInfo *info, int width);
+static void drawcores(const SysInfo *info);
+static void fmtscaled(char *buf, size_t size, double v, double base);
+static int trafficheight(const SysInfo *info, int width);
+static void drawtraffic(const SysInfo *info);
+static int disksheight(const SysInfo *info, int width);
+static void drawdisks(const SysInfo *info);
+static int fsheight(const SysInfo *info, int width);
+static void drawfs(const SysInfo *info);
+static int psiheight(const SysInfo *info, int width);
+static void drawpsi(const SysInfo *info);
+static int procsheight(const SysInfo *info, int width);
+static void drawprocs(const SysInfo *info);
+static int fitpart(char *line, size_t size, int len, int width, const char *part);
+static void drawmemdetail(const SysInfo *info, int x, int y, int width);
+static void drawcpubar(const SysInfo *info, int x, int y, int width);
+static int numaheight(const SysInfo *info, int width);
+static void drawnuma(const SysInfo *info);
+static int irqsheight(const SysInfo *info, int width);
+static void drawirqs(const SysInfo *info);
+static int cgroupsheight(const SysInfo *info, int width);
+static void drawcgroups(const SysInfo *info);
+static int sensorsheight(const SysInfo *info, int width);
+static void drawsensors(const SysInfo *info);
+static int overheadheight(const SysInfo *info, int width);
+static void drawoverhead(const SysInfo *info);
 static void drawseparator(int x, int y, int width, uint16_t fg, uint16_t bg);
 static void drawhexbanner(int x, int y, int width, uint16_t fg, uint16_t bg);
 static void drawhexbackground(int width, int height);
@@ -72,6 +253,93 @@ static const char **getasciiart(const char *system);
 static void drawasciiart(const char **art, int x, int y, int width, int height, uint16_t fg, uint16_t bg);
 
 static char *argv0;
+static int nlevfd = -1;
+static int watchfd = -1;
+static int mountfd = -1;
+static int mountsdirty = 1;
+static int psifd[PsiLast] = { -1, -1, -1 };
+static double psifired[PsiLast];
+
+/* latest complete SysInfo, guarded by the sequence count in shareseq */
+static SysInfo shared;
+static unsigned int shareseq;
+static int notifypipe[2] = { -1, -1 };
+
+static ProcFile pfmeminfo = PROCFILE("/proc/meminfo");
+static ProcFile pfvmstat = PROCFILE("/proc/vmstat");
+static ProcFile pfzram = PROCFILE("/sys/block/zram0/mm_stat");
+static ProcFile pfdiskstats = PROCFILE("/proc/diskstats");
+static ProcFile pfmountinfo = PROCFILE("/proc/self/mountinfo");
+static ProcFile pfstat = PROCFILE("/proc/stat");
+static ProcFile pfloadavg = PROCFILE("/proc/loadavg");
+static ProcFile pfinterrupts = PROCFILE("/proc/interrupts");
+static ProcFile pfsoftirqs = PROCFILE("/proc/softirqs");
+static ProcFile pfstatm = PROCFILE("/proc/self/statm");
+static ProcFile pfresolv = PROCFILE("/etc/resolv.conf");
+static ProcFile pfhostname = PROCFILE("/etc/hostname");
+static ProcFile pfosrelease = PROCFILE("/etc/os-release");
+static ProcFile pfosreleaselib = PROCFILE("/usr/lib/os-release");
+static ProcFile pfpsi[PsiLast] = {
+	[PsiCpu]    = PROCFILE("/proc/pressure/cpu"),
+	[PsiMemory] = PROCFILE("/proc/pressure/memory"),
+	[PsiIo]     = PROCFILE("/proc/pressure/io"),
+};
+
+static CpuStat cpustat;
+static CpuFreq cpufreq;
+static NetDevTable netdevs;
+static DiskTable disks;
+static FsTable fstable;
+static ProcTable procs = { .dirfd = -1 };
+static SensorSet sensors;
+static BatterySet batteries;
+static CgSelf cgself;
+static CgTree cgtree = { .mountfd = -1, .infd = -1 };
+static NodeSet nodes;
+static IrqTable irqtab;
+static IrqTable softtab;
+
+/* scheduler ids, index into collectors */
+enum { CollNet, CollSystem, CollDns, CollHost, CollFs, CollPsi };
+
+static const Collector collectors[] = {
+	[CollNet]    = { "net",     getnetinfo,     &net_period,     &nlevfd },
+	[CollSystem] = { "system",  collectsystem,  &system_period,  &watchfd },
+	[CollDns]    = { "dns",     collectdns,     &dns_period,     &watchfd },
+	[CollHost]   = { "host",    collecthost,    &host_period,    &watchfd },
+	[CollFs]     = { "fs",      collectfs,      &fs_period,      &mountfd },
+	[CollPsi]    = { "psi",     collectpsi,     &psi_period,     NULL },
+	{ "time",    collecttime,    &time_period,    NULL },
+	{ "uptime",  collectuptime,  &uptime_period,  NULL },
+	{ "memory",  collectmemory,  &memory_period,  NULL },
+	{ "cpu",     collectcpu,     &cpu_period,     NULL },
+	{ "freq",    collectfreq,    &freq_period,    NULL },
+	{ "battery", collectbattery, &battery_period, NULL },
+	{ "netdev",  collectnetdev,  &netdev_period,  NULL },
+	{ "disk",    collectdisk,    &disk_period,    NULL },
+	{ "procs",   collectprocs,   &proc_period,    NULL },
+	{ "sensors", collectsensors, &sensor_period,  NULL },
+	{ "self",    collectself,    &self_period,    NULL },
+	{ "cgroup",  collectcgroup,  &cgroup_period,  NULL },
+	{ "cgtree",  collectcgtree,  &cgtree_period,  NULL },
+	{ "numa",    collectnodes,   &numa_period,    NULL },
+	{ "irqs",    collectirqs,    &irq_period,     NULL },
+};
+
+/* files whose inotify events invalidate a collector, the index is the watch id */
+static const struct {
+	ProcFile *pf;
+	int coll;
+} watched[] = {
+	{ &pfresolv,       CollDns },
+	{ &pfhostname,     CollHost },
+	{ &pfosrelease,    CollSystem },
+	{ &pfosreleaselib, CollSystem },
+};
+
+/* free screen regions left for the optional panels, filled top down */
+static Rect panelareas[2];
+static int npanelareas;
 
 static void
 usage(void)
@@ -109,6 +377,13 @@ printat(const char *str, int x, int y, uint16_t fg, uint16_t bg)
 		tb_set_cell(x + i, y, str[i], fg, bg);
 }
 
+static char *
+nextline(char *s)
+{
+	if ((s = strchr(s, '\n')))
+		s++;
+	return s && *s ? s : NULL;
+}
 
 static void
 getcurrenttime(char *buffer)
@@ -138,38 +413,29 @@ getuptime(char *buffer)
 }
 
 static void
-getmemoryinfo(char *buffer)
+getmemoryinfo(SysInfo *info)
 {
-	FILE *fp;
-	unsigned long memtotal, memfree, memavailable, buffers, cached;
+	MemInfo mi;
+	char *buf, *buffer;
 	unsigned long totalmb, availablemb, usedmb;
 	int usagepercent;
 
-	memtotal = memfree = memavailable = buffers = cached = 0;
-
-	fp = fopen("/proc/meminfo", "r");
-	if (!fp) {
+	buffer = info->memorystr;
+	if (!(buf = pfread(&pfmeminfo))) {
+		memset(&info->meminfo, 0, sizeof(info->meminfo));
 		strcpy(buffer, "Unknown");
 		return;
 	}
+	parsememinfo(buf, &mi);
+	info->meminfo = mi;
 
-	char line[256];
-	while (fgets(line, sizeof(line), fp)) {
-		if (sscanf(line, "MemTotal: %lu kB", &memtotal) == 1) continue;
-		if (sscanf(line, "MemFree: %lu kB", &memfree) == 1) continue;
-		if (sscanf(line, "MemAvailable: %lu kB", &memavailable) == 1) continue;
-		if (sscanf(line, "Buffers: %lu kB", &buffers) == 1) continue;
-		if (sscanf(line, "Cached: %lu kB", &cached) == 1) continue;
-	}
-	fclose(fp);
-
-	if (memtotal > 0) {
-		totalmb = memtotal / 1024;
-		if (memavailable > 0) {
-			availablemb = memavailable / 1024;
+	if (mi.memtotal > 0) {
+		totalmb = mi.memtotal / 1024;
+		if (mi.memavailable > 0) {
+			availablemb = mi.memavailable / 1024;
 			usedmb = totalmb - availablemb;
 		} else {
-			availablemb = (memfree + buffers + cached) / 1024;
+			availablemb = (mi.memfree + mi.buffers + mi.cached) / 1024;
 			usedmb = totalmb - availablemb;
 		}
 		usagepercent = (usedmb * 100) / totalmb;
@@ -181,274 +447,591 @@ getmemoryinfo(char *buffer)
 	}
 }
 
+/* swap traffic from /proc/vmstat and, when there is one, the zram pool */
 static void
-getcpuusage(char *buffer)
+getvmstat(SysInfo *info)
 {
-	static long previdle = 0, prevtotal = 0;
-	FILE *fp;
-	long user, nice, system, idle, iowait, irq, softirq, steal;
-	long total, diffidle, difftotal;
-	int usage;
+	static VmStat prev;
+	static double prevt;
+	VmStat vs;
+	char *buf;
+	double t, page;
+
+	t = now();
+	info->swapinps = info->swapoutps = 0;
+	info->zswapinps = info->zswapoutps = 0;
+	if ((buf = pfread(&pfvmstat))) {
+		parsevmstat(buf, &vs);
+		page = sysconf(_SC_PAGESIZE);
+		if (prevt > 0 && t > prevt && vs.pswpin >= prev.pswpin && vs.pswpout >= prev.pswpout) {
+			info->swapinps = (vs.pswpin - prev.pswpin) * page / (t - prevt);
+			info->swapoutps = (vs.pswpout - prev.pswpout) * page / (t - prevt);
+		}
+		if (prevt > 0 && t > prevt && vs.zswpin >= prev.zswpin && vs.zswpout >= prev.zswpout) {
+			info->zswapinps = (vs.zswpin - prev.zswpin) * page / (t - prevt);
+			info->zswapoutps = (vs.zswpout - prev.zswpout) * page / (t - prevt);
+		}
+		prev = vs;
+		prevt = t;
+	}
+	info->haszram = (buf = pfread(&pfzram)) && parsezram(buf, &info->zram) == 0;
+}
 
-	fp = fopen("/proc/stat", "r");
-	if (!fp) {
-		strcpy(buffer, "Unknown");
+/* the breakdown comes from the per-core sample taken by getcores() */
+static void
+getcpuusage(SysInfo *info)
+{
+	if (info->ncores == 0) {
+		strcpy(info->cpustr, "Unknown");
+		memset(info->cputimes, 0, sizeof(info->cputimes));
 		return;
 	}
+	memcpy(info->cputimes, cpustat.times, sizeof(info->cputimes));
+	snprintf(info->cpustr, MAXSTRLEN, "%d%%",
+	         (int)(100 - info->cputimes[CpuIdle] - info->cputimes[CpuIowait] + 0.5f));
+}
 
-	fscanf(fp, "cpu %ld %ld %ld %ld %ld %ld %ld %ld",
-	       &user, &nice, &system, &idle, &iowait, &irq, &softirq, &steal);
-	fclose(fp);
+static void
+getcores(SysInfo *info, const char *stat)
+{
+	int i;
+
+	if (!stat || cpusample(&cpustat, stat) < 0) {
+		info->ncores = 0;
+		return;
+	}
+
+	info->ncores = cpustat.ncpu < MAXCPUS ? cpustat.ncpu : MAXCPUS;
+	for (i = 0; i < info->ncores; i++)
+		info->corebusy[i] = cpustat.online[i] ? cpustat.busy[i] : -1;
+}
 
-	total = user + nice + system + idle + iowait + irq + softirq + steal;
-	diffidle = idle - previdle;
-	difftotal = total - prevtotal;
+static void
+getload(SysInfo *info, const char *stat)
+{
+	static SchedCounters prev;
+	static double prevt;
+	SchedCounters sc;
+	char *buf;
+	double t;
+
+	if (!(buf = pfread(&pfloadavg)) ||
+	    sscanf(buf, "%lf %lf %lf %d/%d", &info->load[0], &info->load[1],
+	           &info->load[2], &info->lrunnable, &info->lentities) != 5) {
+		info->load[0] = info->load[1] = info->load[2] = -1;
+		info->lrunnable = info->lentities = 0;
+	}
 
-	if (difftotal > 0) {
-		usage = 100 - (diffidle * 100 / difftotal);
-		snprintf(buffer, MAXSTRLEN, "%d%%", usage);
+	if (!stat || schedcounters(stat, &sc) < 0) {
+		memset(&info->sched, 0, sizeof(info->sched));
+		info->ctxtps = info->forkps = 0;
+		return;
+	}
+	t = now();
+	if (prevt > 0 && t > prevt && sc.ctxt >= prev.ctxt && sc.processes >= prev.processes) {
+		info->ctxtps = (sc.ctxt - prev.ctxt) / (t - prevt);
+		info->forkps = (sc.processes - prev.processes) / (t - prevt);
 	} else {
-		strcpy(buffer, "0%");
+		info->ctxtps = info->forkps = 0;
+	}
+	info->sched = sc;
+	prev = sc;
+	prevt = t;
+}
+
+static void
+getbatterystatus(char *buffer)
+{
+	BatteryTotal tot;
+	char detail[128];
+	int len;
+
+	if (batread(&batteries, &tot) == 0) {
+		strcpy(buffer, "No battery detected");
+		return;
 	}
 
-	previdle = idle;
-	prevtotal = total;
+	len = snprintf(detail, sizeof(detail), "%s", tot.status);
+	if (tot.ac >= 0)
+		len += snprintf(detail + len, sizeof(detail) - len, tot.ac ? " on AC" : " on battery");
+	if (tot.watts > 0)
+		len += snprintf(detail + len, sizeof(detail) - len, ", %.1f W", tot.watts);
+	if (tot.minutes >= 0)
+		len += snprintf(detail + len, sizeof(detail) - len, ", %dh %02dm %s",
+		                tot.minutes / 60, tot.minutes % 60,
+		                strcmp(tot.status, "Charging") ? "left" : "to full");
+	if (tot.n > 1)
+		snprintf(detail + len, sizeof(detail) - len, ", %d batteries", tot.n);
+	snprintf(buffer, MAXSTRLEN, "%d%% (%s)", tot.percent, detail);
 }
 
 static void
-getnetworkstatus(char *buffer)
+getnetinfo(SysInfo *info)
 {
-	struct ifaddrs *ifaddr, *ifa;
-	int connectedinterfaces;
+	NlState st;
+	const NlLink *l;
 	char interfacelist[MAXSTRLEN];
-	char seen_interfaces[32][64]; /* Track seen interface names */
-	int seen_count = 0;
-
-	connectedinterfaces = 0;
-	interfacelist[0] = '\0';
+	int i, len, n;
 
-	if (getifaddrs(&ifaddr) == -1) {
-		strcpy(buffer, "Unknown");
+	if (nlquery(&st) < 0) {
+		strcpy(info->networkstr, "Unknown");
+		strcpy(info->vpnstr, "VPN: Unknown");
+		strcpy(info->ipstr, "IP: Unknown");
+		strcpy(info->gatewaystr, "Gateway: Unknown");
 		return;
 	}
 
-	for (ifa = ifaddr; ifa != NULL; ifa = ifa->ifa_next) {
-		int already_seen, i;
-		
-		already_seen = 0;
-		
-		if (ifa->ifa_addr == NULL)
+	/* "Connected: " = 11 chars + null */
+	len = 0;
+	interfacelist[0] = '\0';
+	for (i = 0; i < st.nlinks; i++) {
+		l = &st.links[i];
+		if (!l->hasaddr || strcmp(l->name, "lo") == 0)
 			continue;
-
-		if ((ifa->ifa_addr->sa_family == AF_INET || ifa->ifa_addr->sa_family == AF_INET6) &&
-		    strcmp(ifa->ifa_name, "lo") != 0) {
-			
-			/* Check if we've already seen this interface */
-			for (i = 0; i < seen_count; i++) {
-				if (strcmp(seen_interfaces[i], ifa->ifa_name) == 0) {
-					already_seen = 1;
-					break;
-				}
-			}
-			
-			if (!already_seen && seen_count < 32) {
-				strcpy(seen_interfaces[seen_count], ifa->ifa_name);
-				seen_count++;
-				
-				if (connectedinterfaces > 0)
-					strcat(interfacelist, ", ");
-				strcat(interfacelist, ifa->ifa_name);
-				connectedinterfaces++;
-			}
-		}
+		n = snprintf(interfacelist + len, MAXSTRLEN - 12 - len, "%s%s",
+		             len ? ", " : "", l->name);
+		if (n < 0 || len + n >= MAXSTRLEN - 12)
+			break;
+		len += n;
 	}
 
-	freeifaddrs(ifaddr);
+	if (interfacelist[0])
+		snprintf(info->networkstr, MAXSTRLEN, "Connected: %.*s", MAXSTRLEN - 12, interfacelist);
+	else
+		strcpy(info->networkstr, "No network connection");
 
-	if (connectedinterfaces > 0) {
-		int remaining;
-		
-		remaining = MAXSTRLEN - 12; /* "Connected: " = 11 chars + null */
-		if ((int)strlen(interfacelist) >= remaining) {
-			interfacelist[remaining - 1] = '\0'; /* Ensure it fits */
+	strcpy(info->vpnstr, st.vpn ? "VPN: Active" : "VPN: Inactive");
+	snprintf(info->ipstr, MAXSTRLEN, "IP: %s", st.ipaddr[0] ? st.ipaddr : "Unknown");
+	snprintf(info->gatewaystr, MAXSTRLEN, "Gateway: %s", st.gateway[0] ? st.gateway : "Unknown");
+}
+
+static void
+getdns(char *buffer)
+{
+	char *line;
+
+	for (line = pfread(&pfresolv); line; line = nextline(line)) {
+		if (strncmp(line, "nameserver", 10) == 0) {
+			char *dns = line + 10;
+			int len;
+			while (*dns == ' ' || *dns == '\t') dns++;
+			len = strcspn(dns, "\n");
+			if (len > MAXSTRLEN - 6)
+				len = MAXSTRLEN - 6; /* "DNS: " = 5 chars + null */
+			snprintf(buffer, MAXSTRLEN, "DNS: %.*s", len, dns);
+			return;
 		}
-		snprintf(buffer, MAXSTRLEN, "Connected: %s", interfacelist);
-	} else {
-		strcpy(buffer, "No network connection");
 	}
+	strcpy(buffer, "DNS: Unknown");
 }
 
 static void
-getbatterystatus(char *buffer)
+collecttime(SysInfo *info)
 {
-	FILE *fp, *statusfp;
-	int capacity;
-	char status[32];
+	getcurrenttime(info->timestr);
+}
 
-	char path[MAXSTRLEN];
-	
-	snprintf(path, MAXSTRLEN, "%s/capacity", battery_path);
-	fp = fopen(path, "r");
-	if (fp) {
-		fscanf(fp, "%d", &capacity);
-		fclose(fp);
+static void
+collectuptime(SysInfo *info)
+{
+	getuptime(info->uptimestr);
+}
 
-		strcpy(status, "Unknown");
-		snprintf(path, MAXSTRLEN, "%s/status", battery_path);
-		statusfp = fopen(path, "r");
-		if (statusfp) {
-			fscanf(statusfp, "%s", status);
-			fclose(statusfp);
+static void
+collectmemory(SysInfo *info)
+{
+	getmemoryinfo(info);
+	getvmstat(info);
+}
+
+static void
+collectcpu(SysInfo *info)
+{
+	const char *stat;
+
+	/* /proc/stat is read once and shared by the cpu collectors */
+	stat = pfread(&pfstat);
+	getcores(info, stat);
+	getcpuusage(info);
+	getload(info, stat);
+}
+
+static void
+collectbattery(SysInfo *info)
+{
+	getbatterystatus(info->batterystr);
+}
+
+static void
+collectnetdev(SysInfo *info)
+{
+	int n;
+
+	n = traffic_rows < MAXIFACES ? traffic_rows : MAXIFACES;
+	/* without link events nothing says when a name changed */
+	if (nlevfd < 0)
+		netdevs.relinked = 1;
+	if (netdevsample(&netdevs, now()) < 0)
+		info->nifaces = 0;
+	else
+		info->nifaces = netdevtop(&netdevs, info->ifaces, n);
+}
+
+static void
+collectdisk(SysInfo *info)
+{
+	char *buf;
+	int n;
+
+	info->ndisks = 0;
+	if (!(buf = pfread(&pfdiskstats)))
+		return;
+	disksample(&disks, buf, now());
+	n = disk_rows < MAXDISKS ? disk_rows : MAXDISKS;
+	info->ndisks = disktop(&disks, info->disks, n,
+	                       (disk_partitions ? DiskPartition : 0) | (disk_mapper ? DiskMapper : 0));
+}
+
+static void
+collectfs(SysInfo *info)
+{
+	char *buf;
+
+	/* the mount table is only re-parsed when the kernel flags a change */
+	if (mountsdirty || mountfd < 0) {
+		if ((buf = pfread(&pfmountinfo))) {
+			fsparse(&fstable, buf);
+			mountsdirty = 0;
 		}
+		/* a failed read closes the fd, a later one reopens it */
+		mountfd = pfmountinfo.fd;
+	}
+	fsstat(&fstable, fs_timeout);
+	info->nfs = fstable.n < MAXFS ? fstable.n : MAXFS;
+	if (info->nfs > fs_rows)
+		info->nfs = fs_rows;
+	memcpy(info->fs, fstable.mounts, info->nfs * sizeof(info->fs[0]));
+}
 
-		snprintf(buffer, MAXSTRLEN, "%d%% (%s)", capacity, status);
-	} else {
-		strcpy(buffer, "No battery detected");
+static void
+collectpsi(SysInfo *info)
+{
+	char *buf;
+	double t;
+	int i;
+
+	t = now();
+	for (i = 0; i < PsiLast; i++) {
+		if (!(buf = pfread(&pfpsi[i])) || psiparse(buf, &info->pressure[i]) < 0)
+			info->pressure[i].valid = 0;
+		info->stalled[i] = psifired[i] > 0 && t - psifired[i] < psi_window_us / 1e6;
 	}
 }
 
 static void
-getvpnstatus(char *buffer)
+collectprocs(SysInfo *info)
 {
-	FILE *fp;
-	char line[256];
+	int n;
 
-	fp = popen("ip route show | grep -E '(tun|tap|vpn)' | head -1", "r");
-	if (fp) {
-		if (fgets(line, sizeof(line), fp))
-			strcpy(buffer, "VPN: Active");
-		else
-			strcpy(buffer, "VPN: Inactive");
-		pclose(fp);
-	} else {
-		strcpy(buffer, "VPN: Unknown");
+	info->nprocs = 0;
+	n = proc_threads > 0 ? proc_threads : (int)sysconf(_SC_NPROCESSORS_ONLN);
+	if ((info->ntasks = procscan(&procs, "/proc", now(), n)) < 0) {
+		info->ntasks = 0;
+		return;
 	}
+	info->nrunning = procs.nrunning;
+	n = proc_rows < MAXPROCS ? proc_rows : MAXPROCS;
+	info->nprocs = proctop(&procs, info->topcpu, n, ProcByCpu);
+	proctop(&procs, info->toprss, n, ProcByRss);
 }
 
 static void
-getipaddress(char *buffer)
+collectsensors(SysInfo *info)
 {
-	FILE *fp;
-	char line[256];
-	const char *targets[] = {
-		"1.1.1.1",      /* Cloudflare DNS */
-		"8.8.8.8",      /* Google DNS */
-		"9.9.9.9",      /* Quad9 DNS */
-		"208.67.222.222" /* OpenDNS */
-	};
-	int i;
+	int n;
+
+	n = sensorread(&sensors);
+	if (n > MAXSENSORS)
+		n = MAXSENSORS;
+	if (n > sensor_rows)
+		n = sensor_rows;
+	memcpy(info->sensors, sensors.s, n * sizeof(info->sensors[0]));
+	info->nsensors = n;
+}
 
-	strcpy(buffer, "IP: Unknown");
+static void
+collectfreq(SysInfo *info)
+{
+	unsigned int khz, minkhz, maxkhz;
+	unsigned long long sum;
+	int i, n, online;
 
-	/* Try multiple DNS servers for reliability */
-	for (i = 0; i < 4; i++) {
-		char cmd[256];
-		snprintf(cmd, sizeof(cmd), "ip route get %s 2>/dev/null", targets[i]);
-		
-		fp = popen(cmd, "r");
-		if (!fp)
+	info->hasfreq = 0;
+	if (cpustat.ncpu == 0 || freqsample(&cpufreq, cpustat.ncpu, cpustat.online) < 0)
+		return;
+
+	n = cpufreq.ncpu < MAXCPUS ? cpufreq.ncpu : MAXCPUS;
+	sum = 0;
+	minkhz = maxkhz = 0;
+	online = 0;
+	info->nthrottled = 0;
+	info->throttles = 0;
+	info->npkgthrottled = 0;
+	info->pkgthrottles = 0;
+	for (i = 0; i < cpufreq.npkg; i++) {
+		info->npkgthrottled += cpufreq.pkgthrottled[i];
+		info->pkgthrottles += cpufreq.pkgthrottles[i];
+	}
+	for (i = 0; i < n; i++) {
+		khz = cpufreq.khz[i];
+		info->corefreq[i] = khz && cpufreq.maxkhz[i] ? (float)khz / cpufreq.maxkhz[i] : -1;
+		info->corethrottled[i] = cpufreq.throttled[i];
+		info->nthrottled += cpufreq.throttled[i];
+		info->throttles += cpufreq.throttles[i];
+		if (!khz)
 			continue;
+		sum += khz;
+		if (!online || khz < minkhz)
+			minkhz = khz;
+		if (khz > maxkhz)
+			maxkhz = khz;
+		online++;
+	}
+	if (!online)
+		return;
+	info->hasfreq = 1;
+	info->freqavg = sum / online / 1e6f;
+	info->freqmin = minkhz / 1e6f;
+	info->freqmax = maxkhz / 1e6f;
+}
 
-		if (fgets(line, sizeof(line), fp)) {
-			char *src_pos = strstr(line, " src ");
-			if (src_pos) {
-				char *ip_start = src_pos + 5; /* Skip " src " */
-				char *ip_end = strchr(ip_start, ' ');
-				if (ip_end)
-					*ip_end = '\0';
-				
-				/* Validate IP format and length */
-				if (strlen(ip_start) > 6 && strlen(ip_start) < 40) {
-					line[strcspn(ip_start, "\n")] = 0;
-					if (strlen(ip_start) > MAXSTRLEN - 5) {
-						ip_start[MAXSTRLEN - 5] = '\0';
-					}
-					snprintf(buffer, MAXSTRLEN, "IP: %s", ip_start);
-					pclose(fp);
-					return; /* Success, exit early */
-				}
-			}
-		}
-		pclose(fp);
+/* what this process costs: cpu over the interval and resident memory */
+static void
+collectself(SysInfo *info)
+{
+	static double prevcpu, prevt;
+	struct rusage ru;
+	unsigned long long pages;
+	double cpu, t;
+	char *buf;
+
+	t = now();
+	if (getrusage(RUSAGE_SELF, &ru) == 0) {
+		cpu = ru.ru_utime.tv_sec + ru.ru_utime.tv_usec / 1e6 +
+		      ru.ru_stime.tv_sec + ru.ru_stime.tv_usec / 1e6;
+		info->selfcpu = prevt > 0 && t > prevt ? (cpu - prevcpu) * 100 / (t - prevt) : 0;
+		prevcpu = cpu;
+		prevt = t;
 	}
+	if ((buf = pfread(&pfstatm)) && sscanf(buf, "%*u %llu", &pages) == 1)
+		info->selfrss = pages * sysconf(_SC_PAGESIZE);
+}
 
-	/* Fallback: try getting IP from active interfaces */
-	fp = popen("ip addr show | grep 'inet ' | grep -v '127.0.0.1' | head -1 | awk '{print $2}' | cut -d'/' -f1", "r");
-	if (fp) {
-		if (fgets(line, sizeof(line), fp)) {
-			line[strcspn(line, "\n")] = 0;
-			if (strlen(line) > 6 && strlen(line) < 40) {
-				if (strlen(line) > MAXSTRLEN - 5) {
-					line[MAXSTRLEN - 5] = '\0';
-				}
-				snprintf(buffer, MAXSTRLEN, "IP: %s", line);
-			}
-		}
-		pclose(fp);
+static void
+collectcgroup(SysInfo *info)
+{
+	static int tried;
+
+	/* the cgroup is resolved once; moving between cgroups is not followed */
+	if (!tried) {
+		tried = 1;
+		cgopen(&cgself);
 	}
+	cgsample(&cgself, &info->cg, now());
 }
 
+/* per-node cpu use is the mean of the node's cores from the cpu collector */
 static void
-getgateway(char *buffer)
+collectnodes(SysInfo *info)
 {
-	FILE *fp;
-	char line[256];
+	float sum[NODEMAX];
+	int cnt[NODEMAX];
+	int i, n;
 
-	fp = popen("ip route | awk '/default/ {print $3}' | head -1", "r");
-	if (fp) {
-		if (fgets(line, sizeof(line), fp)) {
-			line[strcspn(line, "\n")] = 0;
-			line[MAXSTRLEN - 10] = '\0'; /* "Gateway: " = 9 chars + null */
-			snprintf(buffer, MAXSTRLEN, "Gateway: %s", line);
-		} else {
-			strcpy(buffer, "Gateway: Unknown");
-		}
-		pclose(fp);
-	} else {
-		strcpy(buffer, "Gateway: Unknown");
+	if ((info->nnodes = noderead(&nodes, now())) < 0) {
+		info->nnodes = 0;
+		return;
+	}
+	memcpy(info->nodes, nodes.n, info->nnodes * sizeof(info->nodes[0]));
+	memset(sum, 0, sizeof(sum));
+	memset(cnt, 0, sizeof(cnt));
+	for (i = 0; i < info->ncores && i < nodes.ncpu; i++) {
+		if ((n = nodes.cpunode[i]) < 0 || info->corebusy[i] < 0)
+			continue;
+		sum[n] += info->corebusy[i];
+		cnt[n]++;
 	}
+	for (n = 0; n < info->nnodes; n++)
+		info->nodebusy[n] = cnt[n] ? sum[n] / cnt[n] : -1;
 }
 
+/*
+ * the n busiest rows of t, binned into the columns of cols by cpu number,
+ * at most MAXIRQCOLS of them. softirqs lists every possible cpu while
+ * interrupts lists the online ones, so columns can't be matched by index;
+ * both headers are ascending, and cpus missing from cols are dropped.
+ */
 static void
-getdns(char *buffer)
+addirqrows(SysInfo *info, const IrqTable *t, const IrqTable *cols, int n, int soft)
 {
-	FILE *fp;
-	char line[256];
-
-	fp = fopen("/etc/resolv.conf", "r");
-	if (fp) {
-		while (fgets(line, sizeof(line), fp)) {
-			if (strncmp(line, "nameserver", 10) == 0) {
-				char *dns = line + 10;
-				while (*dns == ' ' || *dns == '\t') dns++;
-				dns[strcspn(dns, "\n")] = 0;
-				dns[MAXSTRLEN - 6] = '\0'; /* "DNS: " = 5 chars + null */
-				snprintf(buffer, MAXSTRLEN, "DNS: %s", dns);
-				fclose(fp);
-				return;
-			}
+	int top[MAXIRQROWS];
+	IrqHeat *h;
+	int i, c, k, row;
+
+	if (n > MAXIRQROWS - info->nirqs)
+		n = MAXIRQROWS - info->nirqs;
+	n = irqtop(t, top, n);
+	for (i = 0; i < n; i++) {
+		row = top[i];
+		h = &info->irqs[info->nirqs++];
+		memcpy(h->name, t->rows[row].name, sizeof(h->name));
+		memcpy(h->desc, t->rows[row].desc, sizeof(h->desc));
+		h->soft = soft;
+		h->rate = t->rows[row].rate;
+		memset(h->cells, 0, sizeof(h->cells));
+		for (c = k = 0; c < t->ncols; c++) {
+			while (k < cols->ncols && cols->cpu[k] < t->cpu[c])
+				k++;
+			if (k == cols->ncols || k / info->irqspan >= MAXIRQCOLS)
+				break;
+			if (cols->cpu[k] == t->cpu[c])
+				h->cells[k / info->irqspan] += t->rates[(size_t)row * t->colcap + c];
 		}
-		fclose(fp);
 	}
-	strcpy(buffer, "DNS: Unknown");
 }
 
 static void
-collectsysteminfo(SysInfo *info)
+collectirqs(SysInfo *info)
+{
+	ProcFile *pf;
+	int c;
+
+	info->nirqs = 0;
+	pf = &pfinterrupts;
+	if (!pfread(pf) || irqparse(&irqtab, pf->buf, pf->len, now()) < 0 || irqtab.ncols == 0)
+		return;
+	pf = &pfsoftirqs;
+	if (!pfread(pf) || irqparse(&softtab, pf->buf, pf->len, now()) < 0)
+		softtab.nrows = 0;
+
+	info->irqspan = (irqtab.ncols + MAXIRQCOLS - 1) / MAXIRQCOLS;
+	info->irqcols = (irqtab.ncols + info->irqspan - 1) / info->irqspan;
+	info->irqfirst = irqtab.cpu[0];
+	info->irqlast = irqtab.cpu[irqtab.ncols - 1];
+	info->irqtotal = 0;
+	info->irqbusiest = 0;
+	for (c = 0; c < irqtab.ncols; c++) {
+		info->irqtotal += irqtab.cpurate[c];
+		if (irqtab.cpurate[c] > irqtab.cpurate[info->irqbusiest])
+			info->irqbusiest = c;
+	}
+	info->irqbusiestrate = irqtab.cpurate[info->irqbusiest];
+	info->irqbusiest = irqtab.cpu[info->irqbusiest];
+	info->softtotal = 0;
+	for (c = 0; c < softtab.ncols; c++)
+		info->softtotal += softtab.cpurate[c];
+
+	addirqrows(info, &irqtab, &irqtab, irq_rows, 0);
+	if (softtab.ncols > 0)
+		addirqrows(info, &softtab, &irqtab, softirq_rows, 1);
+}
+
+static void
+collectcgtree(SysInfo *info)
+{
+	int n;
+
+	info->ncgroups = 0;
+	if ((info->cgtotal = cgtreescan(&cgtree, now())) < 0) {
+		info->cgtotal = 0;
+		return;
+	}
+	n = cgroup_rows < MAXCGROUPS ? cgroup_rows : MAXCGROUPS;
+	info->ncgroups = cgtreetop(&cgtree, info->cgroups, n, cgroup_sort);
+}
+
+static void
+collectsystem(SysInfo *info)
 {
-	getcurrenttime(info->timestr);
-	getuptime(info->uptimestr);
-	getmemoryinfo(info->memorystr);
-	getcpuusage(info->cpustr);
-	getnetworkstatus(info->networkstr);
-	getbatterystatus(info->batterystr);
-	getvpnstatus(info->vpnstr);
 	detectsystem(info->systemstr);
-	getipaddress(info->ipstr);
-	getgateway(info->gatewaystr);
+}
+
+static void
+collectdns(SysInfo *info)
+{
 	getdns(info->dnsstr);
 }
 
+/*
+ * Everything here may be slow (getpwuid can go through NSS to LDAP or
+ * sssd), so it is gathered once and only refreshed on invalidation.
+ */
+static void
+gethostfacts(HostFacts *hf)
+{
+	struct passwd *pw;
+	struct utsname buf;
+	char *hostbuf;
+
+	pw = getpwuid(getuid());
+	snprintf(hf->user, sizeof(hf->user), "%s", pw ? pw->pw_name : "Unknown");
+
+	strcpy(hf->hostname, "Unknown");
+	if ((hostbuf = pfread(&pfhostname)) && *hostbuf)
+		snprintf(hf->hostname, sizeof(hf->hostname), "%.*s",
+		         (int)strcspn(hostbuf, "\n"), hostbuf);
+
+	if (uname(&buf) != 0) {
+		strcpy(buf.sysname, "Unknown");
+		strcpy(buf.release, "Unknown");
+		strcpy(buf.machine, "Unknown");
+	}
+	strcpy(hf->sysname, buf.sysname);
+	strcpy(hf->release, buf.release);
+	strcpy(hf->machine, buf.machine);
+}
+
+static void
+collecthost(SysInfo *info)
+{
+	gethostfacts(&info->host);
+}
+
+static void
+collectsysteminfo(SysInfo *info)
+{
+	size_t i;
+
+	for (i = 0; i < LENGTH(collectors); i++)
+		runcollector(i, info);
+}
+
+/* run one collector and account its wall time to it */
+static void
+runcollector(int id, SysInfo *info)
+{
+	CollCost *c;
+	double t;
+
+	t = now();
+	collectors[id].fn(info);
+	t = (now() - t) * 1000;
+
+	c = &info->cost[id];
+	c->lastms = t;
+	c->avgms = c->runs ? c->avgms * 0.9f + t * 0.1f : t;
+	c->runs++;
+}
+
+static double
+now(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
 
 static void
 drawseparator(int x, int y, int width, uint16_t fg, uint16_t bg)
@@ -614,36 +1197,33 @@ drawhexbackground(int width, int height)
 static void
 detectsystem(char *buffer)
 {
-	FILE *fp;
-	char line[256];
+	char *line;
+	int len;
 
 	strcpy(buffer, "linux");
 
-	fp = fopen("/etc/os-release", "r");
-	if (!fp) {
-		fp = fopen("/usr/lib/os-release", "r");
-		if (!fp)
-			return;
-	}
+	if (!(line = pfread(&pfosrelease)) && !(line = pfread(&pfosreleaselib)))
+		return;
 
-	while (fgets(line, sizeof(line), fp)) {
+	for (; line; line = nextline(line)) {
 		if (strncmp(line, "ID=", 3) == 0) {
 			char *id;
 			id = line + 3;
 			
 			if (*id == '"') {
 				id++;
-				id[strcspn(id, "\"")] = 0;
+				len = strcspn(id, "\"\n");
 			} else {
-				id[strcspn(id, "\n")] = 0;
+				len = strcspn(id, "\n");
 			}
+			if (len > MAXSTRLEN - 1)
+				len = MAXSTRLEN - 1;
 			
-			strncpy(buffer, id, MAXSTRLEN - 1);
-			buffer[MAXSTRLEN - 1] = '\0';
+			memcpy(buffer, id, len);
+			buffer[len] = '\0';
 			break;
 		}
 	}
-	fclose(fp);
 }
 
 static const char **
@@ -760,21 +1340,799 @@ drawbox(int x, int y, int width, int height, const char *title, uint16_t fg, uin
 	}
 }
 
+static void
+layoutpanels(int width, int height, int hex_width)
+{
+	npanelareas = 0;
+
+	/* below the POWER box, above the footer */
+	panelareas[npanelareas].x = 2;
+	panelareas[npanelareas].y = 42;
+	panelareas[npanelareas].w = hex_width - 4;
+	panelareas[npanelareas].h = height - 5 - 42;
+	npanelareas++;
+
+	/* right of the hex dump on wide terminals */
+	panelareas[npanelareas].x = hex_width + 1;
+	panelareas[npanelareas].y = 6;
+	panelareas[npanelareas].w = width - hex_width - 3;
+	panelareas[npanelareas].h = height - 1 - 6;
+	npanelareas++;
+}
+
+static int
+placepanel(const SysInfo *info, int (*height)(const SysInfo *, int), Rect *r)
+{
+	Rect *a;
+	int i, h;
+
+	for (i = 0; i < npanelareas; i++) {
+		a = &panelareas[i];
+		if (a->w < 24)
+			continue;
+		h = height(info, a->w);
+		if (h > a->h)
+			continue;
+
+		r->x = a->x;
+		r->y = a->y;
+		r->w = a->w;
+		r->h = h;
+		a->y += h + 1;
+		a->h -= h + 1;
+		return 1;
+	}
+	return 0;
+}
+
+static int
+corecols(int width)
+{
+	int cols;
+
+	/* borders and a "%4d " row label, cells in groups of eight */
+	cols = (width - 8) / 8 * 8;
+	return cols < 8 ? 8 : cols;
+}
+
+static int
+coresheight(const SysInfo *info, int width)
+{
+	int cols, rows;
+
+	cols = corecols(width);
+	rows = (info->ncores + cols - 1) / cols;
+	/* a frequency summary and grid below the utilisation one */
+	return 3 + rows + (info->hasfreq ? 1 + rows : 0);
+}
+
+static void
+drawcores(const SysInfo *info)
+{
+	Rect r;
+	char temp[80];
+	float b, f, sum;
+	int i, y, cols, online, maxcpu;
+	uint16_t color;
+
+	if (!show_cores || info->ncores == 0 || !placepanel(info, coresheight, &r))
+		return;
+
+	drawbox(r.x, r.y, r.w, r.h, " CORES ", TB_RED, TB_BLACK);
+
+	sum = 0;
+	online = 0;
+	maxcpu = -1;
+	for (i = 0; i < info->ncores; i++) {
+		if (info->corebusy[i] < 0)
+			continue;
+		sum += info->corebusy[i];
+		online++;
+		if (maxcpu < 0 || info->corebusy[i] > info->corebusy[maxcpu])
+			maxcpu = i;
+	}
+	if (maxcpu < 0)
+		return;
+	snprintf(temp, sizeof(temp), "avg %d%%  max cpu%d %d%%  online %d/%d",
+	         (int)(sum / online), maxcpu, (int)info->corebusy[maxcpu],
+	         online, info->ncores);
+	printcenteredin(temp, r.x, r.y + 1, r.w, TB_WHITE | TB_BOLD, TB_BLACK);
+
+	cols = corecols(r.w);
+	for (i = 0; i < info->ncores; i++) {
+		if (i % cols == 0) {
+			snprintf(temp, sizeof(temp), "%4d", i);
+			printat(temp, r.x + 1, r.y + 2 + i / cols, TB_BLACK | TB_BRIGHT, TB_BLACK);
+		}
+		b = info->corebusy[i];
+		if (b < 0) {
+			tb_set_cell(r.x + 6 + i % cols, r.y + 2 + i / cols, 0x00B7,
+			            TB_BLACK | TB_BRIGHT, TB_BLACK);
+			continue;
+		}
+		color = b > 80 ? TB_RED : b > 60 ? TB_YELLOW : TB_GREEN;
+		/* U+2581..U+2588 lower eighth to full block */
+		tb_set_cell(r.x + 6 + i % cols, r.y + 2 + i / cols,
+		            0x2581 + (b >= 100 ? 7 : (int)(b * 8 / 100)), color, TB_BLACK);
+	}
+
+	if (!info->hasfreq)
+		return;
+	y = r.y + 2 + (info->ncores + cols - 1) / cols;
+	if (info->nthrottled || info->npkgthrottled)
+		snprintf(temp, sizeof(temp), "freq avg %.2f GHz  %.2f-%.2f  throttled %d cores %d pkgs",
+		         info->freqavg, info->freqmin, info->freqmax, info->nthrottled, info->npkgthrottled);
+	else
+		snprintf(temp, sizeof(temp), "freq avg %.2f GHz  %.2f-%.2f  throttle events core %llu pkg %llu",
+		         info->freqavg, info->freqmin, info->freqmax, info->throttles, info->pkgthrottles);
+	printcenteredin(temp, r.x, y, r.w, info->nthrottled || info->npkgthrottled ?
+	                TB_MAGENTA | TB_BOLD : TB_WHITE | TB_BOLD, TB_BLACK);
+	for (i = 0; i < info->ncores; i++) {
+		if (i % cols == 0) {
+			snprintf(temp, sizeof(temp), "%4d", i);
+			printat(temp, r.x + 1, y + 1 + i / cols, TB_BLACK | TB_BRIGHT, TB_BLACK);
+		}
+		f = info->corefreq[i];
+		if (f < 0) {
+			tb_set_cell(r.x + 6 + i % cols, y + 1 + i / cols, 0x00B7,
+			            TB_BLACK | TB_BRIGHT, TB_BLACK);
+			continue;
+		}
+		/* height is the share of the core's max clock, magenta when it was throttled */
+		color = info->corethrottled[i] ? TB_MAGENTA : TB_BLUE;
+		tb_set_cell(r.x + 6 + i % cols, y + 1 + i / cols,
+		            0x2581 + (f >= 1 ? 7 : (int)(f * 8)), color, TB_BLACK);
+	}
+}
+
+/* v scaled by powers of base with a K/M/G/T suffix */
+static void
+fmtscaled(char *buf, size_t size, double v, double base)
+{
+	const char *suffix = "KMGTP";
+	int i;
+
+	if (v < base) {
+		snprintf(buf, size, "%.0f", v);
+		return;
+	}
+	for (i = -1; v >= base && i < 4; i++)
+		v /= base;
+	snprintf(buf, size, "%.1f%c", v, suffix[i]);
+}
+
+static int
+trafficheight(const SysInfo *info, int width)
+{
+	/* too narrow for the columns, so never fits */
+	if (width < 60)
+		return INT_MAX;
+	return 3 + info->nifaces;
+}
+
+static void
+drawtraffic(const SysInfo *info)
+{
+	const NetDev *d;
+	Rect r;
+	char line[MAXSTRLEN];
+	char rx[16], tx[16], rxp[16], txp[16], err[16], drop[16];
+	int i;
+
+	if (!show_traffic || info->nifaces == 0 || !placepanel(info, trafficheight, &r))
+		return;
+
+	drawbox(r.x, r.y, r.w, r.h, " TRAFFIC ", TB_CYAN, TB_BLACK);
+	snprintf(line, sizeof(line), "%-12s %8s %8s %8s %8s %6s %6s",
+	         "iface", "rx B/s", "tx B/s", "rx pk/s", "tx pk/s", "err/s", "drop/s");
+	printat(line, r.x + 2, r.y + 1, TB_WHITE | TB_BOLD, TB_BLACK);
+
+	for (i = 0; i < info->nifaces; i++) {
+		d = &info->ifaces[i];
+		fmtscaled(rx, sizeof(rx), d->rxbps, 1024);
+		fmtscaled(tx, sizeof(tx), d->txbps, 1024);
+		fmtscaled(rxp, sizeof(rxp), d->rxpps, 1000);
+		fmtscaled(txp, sizeof(txp), d->txpps, 1000);
+		fmtscaled(err, sizeof(err), d->errps, 1000);
+		fmtscaled(drop, sizeof(drop), d->dropps, 1000);
+		snprintf(line, sizeof(line), "%-12.12s %8s %8s %8s %8s %6s %6s",
+		         d->name, rx, tx, rxp, txp, err, drop);
+		printat(line, r.x + 2, r.y + 2 + i,
+		        d->errps > 0 || d->dropps > 0 ? TB_RED : TB_CYAN, TB_BLACK);
+	}
+}
+
+static int
+disksheight(const SysInfo *info, int width)
+{
+	if (width < 60)
+		return INT_MAX;
+	return 3 + info->ndisks;
+}
+
+static void
+drawdisks(const SysInfo *info)
+{
+	const DiskDev *d;
+	Rect r;
+	char line[MAXSTRLEN];
+	char riops[16], wiops[16], rbps[16], wbps[16];
+	int i;
+
+	if (!show_disks || info->ndisks == 0 || !placepanel(info, disksheight, &r))
+		return;
+
+	drawbox(r.x, r.y, r.w, r.h, " DISKS ", TB_CYAN, TB_BLACK);
+	snprintf(line, sizeof(line), "%-12s %7s %7s %8s %8s %7s %5s",
+	         "device", "r/s", "w/s", "rd B/s", "wr B/s", "await", "util");
+	printat(line, r.x + 2, r.y + 1, TB_WHITE | TB_BOLD, TB_BLACK);
+
+	for (i = 0; i < info->ndisks; i++) {
+		d = &info->disks[i];
+		fmtscaled(riops, sizeof(riops), d->riops, 1000);
+		fmtscaled(wiops, sizeof(wiops), d->wiops, 1000);
+		fmtscaled(rbps, sizeof(rbps), d->rbps, 1024);
+		fmtscaled(wbps, sizeof(wbps), d->wbps, 1024);
+		snprintf(line, sizeof(line), "%-12.12s %7s %7s %8s %8s %5.1fms %4.0f%%",
+		         d->name, riops, wiops, rbps, wbps, d->await, d->util);
+		printat(line, r.x + 2, r.y + 2 + i,
+		        d->util >= 90 ? TB_RED : d->util >= 60 ? TB_YELLOW : TB_CYAN, TB_BLACK);
+	}
+}
+
+static int
+fsheight(const SysInfo *info, int width)
+{
+	if (width < 60)
+		return INT_MAX;
+	return 3 + info->nfs;
+}
+
+static void
+drawfs(const SysInfo *info)
+{
+	const FsMount *m;
+	Rect r;
+	char line[MAXSTRLEN];
+	char size[16], used[16], avail[16];
+	int i, perc;
+
+	if (!show_fs || info->nfs == 0 || !placepanel(info, fsheight, &r))
+		return;
+
+	drawbox(r.x, r.y, r.w, r.h, " FILESYSTEMS ", TB_GREEN, TB_BLACK);
+	snprintf(line, sizeof(line), "%-20s %-8s %7s %7s %7s %4s",
+	         "mount", "type", "size", "used", "avail", "use");
+	printat(line, r.x + 2, r.y + 1, TB_WHITE | TB_BOLD, TB_BLACK);
+
+	for (i = 0; i < info->nfs; i++) {
+		m = &info->fs[i];
+		if (m->hung || !m->valid) {
+			snprintf(line, sizeof(line), "%-20.20s %-8.8s %s", m->path, m->type,
+			         m->hung ? "not responding" : "unavailable");
+			printat(line, r.x + 2, r.y + 2 + i, TB_RED, TB_BLACK);
+			continue;
+		}
+		fmtscaled(size, sizeof(size), m->size, 1024);
+		fmtscaled(used, sizeof(used), m->used, 1024);
+		fmtscaled(avail, sizeof(avail), m->avail, 1024);
+		/* like df, reserved blocks do not count as free */
+		perc = m->used + m->avail ? (int)(m->used * 100 / (m->used + m->avail)) : 0;
+		snprintf(line, sizeof(line), "%-20.20s %-8.8s %7s %7s %7s %3d%%",
+		         m->path, m->type, size, used, avail, perc);
+		printat(line, r.x + 2, r.y + 2 + i,
+		        perc >= 90 ? TB_RED : perc >= 75 ? TB_YELLOW : TB_GREEN, TB_BLACK);
+	}
+}
+
+static int
+psiheight(const SysInfo *info, int width)
+{
+	(void)info;
+	if (width < 56)
+		return INT_MAX;
+	return 3 + PsiLast;
+}
+
+static void
+drawpsi(const SysInfo *info)
+{
+	static const char *names[PsiLast] = { "cpu", "memory", "io" };
+	const Pressure *p;
+	Rect r;
+	char line[MAXSTRLEN], full10[16], full60[16];
+	int i;
+
+	if (!show_psi || !info->pressure[PsiCpu].valid || !placepanel(info, psiheight, &r))
+		return;
+
+	drawbox(r.x, r.y, r.w, r.h, " PRESSURE ", TB_MAGENTA, TB_BLACK);
+	snprintf(line, sizeof(line), "%-8s %9s %9s %9s %9s",
+	         "", "some 10s", "some 60s", "full 10s", "full 60s");
+	printat(line, r.x + 2, r.y + 1, TB_WHITE | TB_BOLD, TB_BLACK);
+
+	for (i = 0; i < PsiLast; i++) {
+		p = &info->pressure[i];
+		if (!p->valid)
+			continue;
+		snprintf(full10, sizeof(full10), p->hasfull ? "%.2f%%" : "-", p->full10);
+		snprintf(full60, sizeof(full60), p->hasfull ? "%.2f%%" : "-", p->full60);
+		snprintf(line, sizeof(line), "%-8s %8.2f%% %8.2f%% %9s %9s%s",
+		         names[i], p->some10, p->some60, full10, full60,
+		         info->stalled[i] ? "  STALL" : "");
+		printat(line, r.x + 2, r.y + 2 + i,
+		        info->stalled[i] || p->some10 >= 10 ? TB_RED :
+		        p->some10 >= 1 ? TB_YELLOW : TB_GREEN, TB_BLACK);
+	}
+}
+
+static int
+procsheight(const SysInfo *info, int width)
+{
+	if (width < 40)
+		return INT_MAX;
+	return 4 + info->nprocs;
+}
+
+/* by CPU on the left, by RSS on the right when there is room */
+static void
+drawprocs(const SysInfo *info)
+{
+	const Proc *p;
+	Rect r;
+	char line[MAXSTRLEN], rss[16];
+	int i, cols, colw;
+
+	if (!show_procs || info->nprocs == 0 || !placepanel(info, procsheight, &r))
+		return;
+
+	drawbox(r.x, r.y, r.w, r.h, " PROCESSES ", TB_BLUE, TB_BLACK);
+	snprintf(line, sizeof(line), "%d tasks, %d running", info->ntasks, info->nrunning);
+	printcenteredin(line, r.x, r.y + 1, r.w, TB_WHITE, TB_BLACK);
+
+	cols = r.w >= 80 ? 2 : 1;
+	colw = (r.w - 4) / cols;
+	snprintf(line, sizeof(line), "%7s %-15s %s %6s %7s", "pid", "command", "s", "cpu", "rss");
+	printat(line, r.x + 2, r.y + 2, TB_WHITE | TB_BOLD, TB_BLACK);
+	if (cols == 2)
+		printat(line, r.x + 2 + colw, r.y + 2, TB_WHITE | TB_BOLD, TB_BLACK);
+
+	for (i = 0; i < info->nprocs; i++) {
+		p = &info->topcpu[i];
+		fmtscaled(rss, sizeof(rss), p->rss, 1024);
+		snprintf(line, sizeof(line), "%7d %-15.15s %c %5.1f%% %7s",
+		         p->pid, p->comm, p->state, p->cpu, rss);
+		printat(line, r.x + 2, r.y + 3 + i,
+		        p->cpu >= 80 ? TB_RED : p->cpu >= 20 ? TB_YELLOW : TB_CYAN, TB_BLACK);
+		if (cols < 2)
+			continue;
+		p = &info->toprss[i];
+		fmtscaled(rss, sizeof(rss), p->rss, 1024);
+		snprintf(line, sizeof(line), "%7d %-15.15s %c %5.1f%% %7s",
+		         p->pid, p->comm, p->state, p->cpu, rss);
+		printat(line, r.x + 2 + colw, r.y + 3 + i, TB_CYAN, TB_BLACK);
+	}
+}
+
+/* append part to the len bytes of line if it still fits inside a box width wide */
+static int
+fitpart(char *line, size_t size, int len, int width, const char *part)
+{
+	int n;
+
+	n = strlen(part);
+	if (len + n > width - 2 || (size_t)(len + n) >= size)
+		return len;
+	memcpy(line + len, part, n + 1);
+	return len + n;
+}
+
+/*
+ * swap, dirty pages, slab and the compressed and huge page pools, four
+ * lines; the parts that no longer fit a narrow box are left off
+ */
+static void
+drawmemdetail(const SysInfo *info, int x, int y, int width)
+{
+	const MemInfo *mi = &info->meminfo;
+	char line[MAXSTRLEN], part[64], a[16], b[16];
+	int len;
+
+	if (mi->memtotal == 0)
+		return;
+
+	line[0] = '\0';
+	if (mi->swaptotal) {
+		fmtscaled(a, sizeof(a), (mi->swaptotal - mi->swapfree) * 1024.0, 1024);
+		fmtscaled(b, sizeof(b), mi->swaptotal * 1024.0, 1024);
+		snprintf(part, sizeof(part), "Swap %s/%s", a, b);
+		len = fitpart(line, sizeof(line), 0, width, part);
+		fmtscaled(a, sizeof(a), info->swapinps, 1024);
+		fmtscaled(b, sizeof(b), info->swapoutps, 1024);
+		snprintf(part, sizeof(part), "  in %s/s out %s/s", a, b);
+		len = fitpart(line, sizeof(line), len, width, part);
+		/* swap-ins served from the zswap pool never reach the device */
+		if (mi->zswapped || info->zswapinps + info->zswapoutps > 0) {
+			fmtscaled(a, sizeof(a), info->zswapinps, 1024);
+			fmtscaled(b, sizeof(b), info->zswapoutps, 1024);
+			snprintf(part, sizeof(part), "  zswap in %s/s out %s/s", a, b);
+			fitpart(line, sizeof(line), len, width, part);
+		}
+	} else {
+		fitpart(line, sizeof(line), 0, width, "Swap none");
+	}
+	printcenteredin(line, x, y, width,
+	                info->swapinps + info->swapoutps + info->zswapinps + info->zswapoutps > 0 ?
+	                TB_YELLOW : TB_CYAN, TB_BLACK);
+
+	line[0] = '\0';
+	fmtscaled(a, sizeof(a), mi->dirty * 1024.0, 1024);
+	snprintf(part, sizeof(part), "Dirty %s", a);
+	len = fitpart(line, sizeof(line), 0, width, part);
+	fmtscaled(a, sizeof(a), mi->writeback * 1024.0, 1024);
+	snprintf(part, sizeof(part), "  Wback %s", a);
+	fitpart(line, sizeof(line), len, width, part);
+	printcenteredin(line, x, y + 1, width, TB_CYAN, TB_BLACK);
+
+	line[0] = '\0';
+	fmtscaled(a, sizeof(a), mi->sreclaimable * 1024.0, 1024);
+	fmtscaled(b, sizeof(b), mi->sunreclaim * 1024.0, 1024);
+	snprintf(part, sizeof(part), "Slab %s rec %s unrec", a, b);
+	fitpart(line, sizeof(line), 0, width, part);
+	printcenteredin(line, x, y + 2, width, TB_CYAN, TB_BLACK);
+
+	/* the pools that are absent on most machines only show up when in use */
+	line[0] = '\0';
+	fmtscaled(a, sizeof(a), mi->anonhugepages * 1024.0, 1024);
+	snprintf(part, sizeof(part), "THP %s", a);
+	len = fitpart(line, sizeof(line), 0, width, part);
+	if (mi->hugepagestotal) {
+		fmtscaled(a, sizeof(a), mi->hugepagesize * 1024.0, 1024);
+		snprintf(part, sizeof(part), "  Huge %llu/%llu x%s",
+		         mi->hugepagestotal - mi->hugepagesfree, mi->hugepagestotal, a);
+		len = fitpart(line, sizeof(line), len, width, part);
+	}
+	if (mi->zswapped) {
+		fmtscaled(a, sizeof(a), mi->zswap * 1024.0, 1024);
+		fmtscaled(b, sizeof(b), mi->zswapped * 1024.0, 1024);
+		snprintf(part, sizeof(part), "  zswap %s in %s", b, a);
+		len = fitpart(line, sizeof(line), len, width, part);
+	}
+	if (info->haszram && info->zram.orig) {
+		fmtscaled(a, sizeof(a), info->zram.orig, 1024);
+		fmtscaled(b, sizeof(b), info->zram.used, 1024);
+		snprintf(part, sizeof(part), "  zram %s in %s", a, b);
+		fitpart(line, sizeof(line), len, width, part);
+	}
+	printcenteredin(line, x, y + 3, width, TB_CYAN, TB_BLACK);
+}
+
+/* where the non-idle cpu time went, as a bar over a legend */
+static void
+drawcpubar(const SysInfo *info, int x, int y, int width)
+{
+	static const struct {
+		const char *label;
+		int f[2];
+		uint16_t color;
+	} parts[] = {
+		{ "us", { CpuUser, -1 },             TB_GREEN },
+		{ "ni", { CpuNice, -1 },             TB_BLUE },
+		{ "sy", { CpuSystem, -1 },           TB_RED },
+		{ "hi", { CpuIrq, CpuSoftirq },      TB_MAGENTA },
+		{ "wa", { CpuIowait, -1 },           TB_YELLOW },
+		{ "st", { CpuSteal, -1 },            TB_CYAN },
+		{ "gu", { CpuGuest, CpuGuestNice },  TB_WHITE },
+	};
+	char temp[16];
+	float v[LENGTH(parts)], cum;
+	int shown[LENGTH(parts)];
+	int i, from, to, len, lx;
+
+	len = 0;
+	for (i = 0; i < (int)LENGTH(parts); i++) {
+		v[i] = info->cputimes[parts[i].f[0]] +
+		       (parts[i].f[1] >= 0 ? info->cputimes[parts[i].f[1]] : 0);
+		shown[i] = snprintf(temp, sizeof(temp), "%s %d ", parts[i].label, (int)(v[i] + 0.5f));
+		len += shown[i];
+	}
+	/* a legend too wide for the bar loses its idle fields first, then its tail */
+	for (i = LENGTH(parts) - 1; i >= 0 && len - 1 > width; i--)
+		if ((int)(v[i] + 0.5f) == 0) {
+			len -= shown[i];
+			shown[i] = 0;
+		}
+	for (i = LENGTH(parts) - 1; i >= 0 && len - 1 > width; i--) {
+		len -= shown[i];
+		shown[i] = 0;
+	}
+
+	/* segment ends come from the running sum so rounding does not drift */
+	cum = 0;
+	from = 0;
+	for (i = 0; i < (int)LENGTH(parts); i++) {
+		cum += v[i];
+		to = cum >= 100 ? width : (int)(cum * width / 100 + 0.5f);
+		for (; from < to; from++)
+			tb_set_cell(x + from, y, 0x2588, parts[i].color, TB_BLACK);
+	}
+	for (; from < width; from++)
+		tb_set_cell(x + from, y, 0x2591, TB_BLACK | TB_BRIGHT, TB_BLACK);
+
+	lx = x + (width - len + 1) / 2;
+	if (lx < x)
+		lx = x;
+	for (i = 0; i < (int)LENGTH(parts); i++) {
+		if (!shown[i])
+			continue;
+		snprintf(temp, sizeof(temp), "%s %d ", parts[i].label, (int)(v[i] + 0.5f));
+		printat(temp, lx, y + 1, parts[i].color, TB_BLACK);
+		lx += strlen(temp);
+	}
+}
+
+static int
+numaheight(const SysInfo *info, int width)
+{
+	if (width < 64)
+		return INT_MAX;
+	return 4 + info->nnodes;
+}
+
+static void
+drawnuma(const SysInfo *info)
+{
+	const Node *n;
+	Rect r;
+	char line[MAXSTRLEN], busy[16], freestr[16], total[16], miss[16], foreign[16];
+	int i;
+	uint16_t fg;
+
+	/* one node has nothing to be imbalanced against */
+	if (!show_numa || info->nnodes < 2 || !placepanel(info, numaheight, &r))
+		return;
+
+	drawbox(r.x, r.y, r.w, r.h, " NUMA ", TB_MAGENTA, TB_BLACK);
+	snprintf(line, sizeof(line), "%d nodes", info->nnodes);
+	printcenteredin(line, r.x, r.y + 1, r.w, TB_WHITE, TB_BLACK);
+	snprintf(line, sizeof(line), "%4s %5s %6s %17s %9s %9s",
+	         "node", "cpus", "busy", "free / total", "miss/s", "foreign/s");
+	printat(line, r.x + 2, r.y + 2, TB_WHITE | TB_BOLD, TB_BLACK);
+
+	for (i = 0; i < info->nnodes; i++) {
+		n = &info->nodes[i];
+		if (info->nodebusy[i] < 0)
+			strcpy(busy, "-");
+		else
+			snprintf(busy, sizeof(busy), "%.0f%%", info->nodebusy[i]);
+		fmtscaled(freestr, sizeof(freestr), n->memfree * 1024.0, 1024);
+		fmtscaled(total, sizeof(total), n->memtotal * 1024.0, 1024);
+		fmtscaled(miss, sizeof(miss), n->missps, 1000);
+		fmtscaled(foreign, sizeof(foreign), n->foreignps, 1000);
+		snprintf(line, sizeof(line), "%4d %5d %6s %8s / %6s %9s %9s",
+		         n->id, n->ncpus, busy, freestr, total, miss, foreign);
+		/* a node short on memory pushes its allocations onto the others */
+		fg = n->memtotal && n->memfree * 10 < n->memtotal ? TB_RED :
+		     n->missps + n->foreignps > 0 ? TB_YELLOW : TB_CYAN;
+		printat(line, r.x + 2, r.y + 3 + i, fg, TB_BLACK);
+	}
+}
+
+static int
+irqsheight(const SysInfo *info, int width)
+{
+	if (width < 48)
+		return INT_MAX;
+	return 4 + info->nirqs;
+}
+
+/*
+ * Each row is shaded against its own busiest column, so an interrupt
+ * pinned to one cpu stands out however low its absolute rate is.
+ */
+static void
+drawirqs(const SysInfo *info)
+{
+	static const uint32_t shades[] = { 0x00B7, 0x2591, 0x2592, 0x2593, 0x2588 };
+	static const uint16_t colors[] = { TB_BLACK | TB_BRIGHT, TB_CYAN, TB_GREEN, TB_YELLOW, TB_RED };
+	const IrqHeat *h;
+	Rect r;
+	char line[MAXSTRLEN], a[16], b[16], c[16];
+	float cells[MAXIRQCOLS], max;
+	int i, j, k, ncells, fold, level;
+
+	if (!show_irqs || info->nirqs == 0 || !placepanel(info, irqsheight, &r))
+		return;
+
+	drawbox(r.x, r.y, r.w, r.h, " INTERRUPTS ", TB_YELLOW, TB_BLACK);
+	fmtscaled(a, sizeof(a), info->irqtotal, 1000);
+	fmtscaled(b, sizeof(b), info->softtotal, 1000);
+	fmtscaled(c, sizeof(c), info->irqbusiestrate, 1000);
+	snprintf(line, sizeof(line), "irq %s/s  softirq %s/s  busiest cpu%d %s/s",
+	         a, b, info->irqbusiest, c);
+	printcenteredin(line, r.x, r.y + 1, r.w, TB_WHITE, TB_BLACK);
+
+	/* fold columns again when the panel is narrower than the cpus */
+	ncells = r.w - 4 - 30;
+	fold = (info->irqcols + ncells - 1) / ncells;
+	ncells = (info->irqcols + fold - 1) / fold;
+	snprintf(line, sizeof(line), "%-6s %-14s %7s cpu%d", "irq", "device", "rate", info->irqfirst);
+	printat(line, r.x + 2, r.y + 2, TB_WHITE | TB_BOLD, TB_BLACK);
+	snprintf(line, sizeof(line), "cpu%d", info->irqlast);
+	if (ncells > (int)strlen(line) + 8)
+		printat(line, r.x + 2 + 30 + ncells - (int)strlen(line), r.y + 2, TB_WHITE | TB_BOLD, TB_BLACK);
+
+	for (i = 0; i < info->nirqs; i++) {
+		h = &info->irqs[i];
+		fmtscaled(a, sizeof(a), h->rate, 1000);
+		snprintf(line, sizeof(line), "%-6.6s %-14.14s %7s", h->name, h->desc, a);
+		printat(line, r.x + 2, r.y + 3 + i, h->soft ? TB_MAGENTA : TB_CYAN, TB_BLACK);
+
+		max = 0;
+		for (j = 0; j < ncells; j++) {
+			cells[j] = 0;
+			for (k = j * fold; k < (j + 1) * fold && k < info->irqcols; k++)
+				cells[j] += h->cells[k];
+			if (cells[j] > max)
+				max = cells[j];
+		}
+		for (j = 0; j < ncells; j++) {
+			level = cells[j] <= 0 || max <= 0 ? 0 : 1 + (int)(cells[j] * 3.999f / max);
+			tb_set_cell(r.x + 2 + 30 + j, r.y + 3 + i, shades[level], colors[level], TB_BLACK);
+		}
+	}
+}
+
+static int
+cgroupsheight(const SysInfo *info, int width)
+{
+	if (width < 48)
+		return INT_MAX;
+	return 4 + info->ncgroups;
+}
+
+static void
+drawcgroups(const SysInfo *info)
+{
+	static const char *keys[] = { [CgByCpu] = "cpu", [CgByMem] = "memory", [CgByIo] = "io" };
+	const CgStat *c;
+	Rect r;
+	char line[MAXSTRLEN], mem[16], io[16];
+	int i;
+
+	if (!show_cgroups || info->ncgroups == 0 || !placepanel(info, cgroupsheight, &r))
+		return;
+
+	drawbox(r.x, r.y, r.w, r.h, " CGROUPS ", TB_GREEN, TB_BLACK);
+	snprintf(line, sizeof(line), "%d cgroups, by %s", info->cgtotal,
+	         keys[cgroup_sort >= CgByCpu && cgroup_sort <= CgByIo ? cgroup_sort : CgByCpu]);
+	printcenteredin(line, r.x, r.y + 1, r.w, TB_WHITE, TB_BLACK);
+	snprintf(line, sizeof(line), "%6s %7s %7s  %s", "cpu", "mem", "io/s", "cgroup");
+	printat(line, r.x + 2, r.y + 2, TB_WHITE | TB_BOLD, TB_BLACK);
+
+	for (i = 0; i < info->ncgroups; i++) {
+		c = &info->cgroups[i];
+		fmtscaled(mem, sizeof(mem), c->mem, 1024);
+		fmtscaled(io, sizeof(io), c->io, 1024);
+		snprintf(line, sizeof(line), "%5.1f%% %7s %7s  %.*s", c->cpu * 100, mem, io,
+		         r.w - 30 > 0 ? r.w - 30 : 0, c->path);
+		printat(line, r.x + 2, r.y + 3 + i,
+		        c->cpu >= 0.8 ? TB_RED : c->cpu >= 0.2 ? TB_YELLOW : TB_CYAN, TB_BLACK);
+	}
+}
+
+static int
+sensorsheight(const SysInfo *info, int width)
+{
+	if (width < 56)
+		return INT_MAX;
+	return 3 + info->nsensors;
+}
+
+static void
+drawsensors(const SysInfo *info)
+{
+	static const char *units[] = { [SensorTemp] = "C", [SensorFan] = "RPM", [SensorVolt] = "V" };
+	const Sensor *s;
+	Rect r;
+	char line[MAXSTRLEN], value[24], limits[32];
+	const char *flag;
+	uint16_t fg;
+	int i;
+
+	if (!show_sensors || info->nsensors == 0 || !placepanel(info, sensorsheight, &r))
+		return;
+
+	drawbox(r.x, r.y, r.w, r.h, " SENSORS ", TB_RED, TB_BLACK);
+	snprintf(line, sizeof(line), "%-14s %-16s %10s  %s", "chip", "sensor", "value", "limits");
+	printat(line, r.x + 2, r.y + 1, TB_WHITE | TB_BOLD, TB_BLACK);
+
+	for (i = 0; i < info->nsensors; i++) {
+		s = &info->sensors[i];
+		snprintf(value, sizeof(value), s->kind == SensorVolt ? "%.2f %s" : "%.0f %s",
+		         s->value, units[s->kind]);
+		limits[0] = '\0';
+		if (s->max > 0 && s->crit > 0)
+			snprintf(limits, sizeof(limits), "max %.0f crit %.0f", s->max, s->crit);
+		else if (s->max > 0 || s->crit > 0)
+			snprintf(limits, sizeof(limits), "%s %.0f", s->max > 0 ? "max" : "crit",
+			         s->max > 0 ? s->max : s->crit);
+
+		/* past max is where firmware starts throttling, past crit it shuts down */
+		flag = "";
+		fg = s->kind == SensorTemp ? TB_GREEN : TB_CYAN;
+		if (!s->valid) {
+			snprintf(value, sizeof(value), "n/a");
+			fg = TB_WHITE;
+		} else if (s->crit > 0 && s->value >= s->crit) {
+			flag = "  CRITICAL";
+			fg = TB_RED | TB_BOLD;
+		} else if (s->max > 0 && s->value >= s->max) {
+			flag = "  OVER MAX";
+			fg = TB_RED;
+		} else if (s->max > 0 && s->value >= s->max - 10) {
+			fg = TB_YELLOW;
+		}
+		snprintf(line, sizeof(line), "%-14.14s %-16.16s %10s  %s%s",
+		         s->chip, s->label, value, limits, flag);
+		printat(line, r.x + 2, r.y + 2 + i, fg, TB_BLACK);
+	}
+}
+
+static int
+overheadheight(const SysInfo *info, int width)
+{
+	int cols;
+
+	(void)info;
+	if ((cols = (width - 4) / 20) < 1)
+		return INT_MAX;
+	return 4 + ((int)LENGTH(collectors) + cols - 1) / cols;
+}
+
+/* this process's own cost, and what each collector spends per run */
+static void
+drawoverhead(const SysInfo *info)
+{
+	Rect r;
+	char line[MAXSTRLEN], rss[16];
+	double persec;
+	size_t i;
+	int cols;
+
+	if (!show_overhead || !placepanel(info, overheadheight, &r))
+		return;
+
+	drawbox(r.x, r.y, r.w, r.h, " OVERHEAD ", TB_WHITE, TB_BLACK);
+	persec = 0;
+	for (i = 0; i < LENGTH(collectors); i++)
+		if (*collectors[i].period > 0)
+			persec += info->cost[i].avgms / *collectors[i].period;
+	fmtscaled(rss, sizeof(rss), info->selfrss, 1024);
+	snprintf(line, sizeof(line), "cpu %.1f%%  rss %s  collectors %.2f ms/s",
+	         info->selfcpu, rss, persec);
+	printcenteredin(line, r.x, r.y + 1, r.w, TB_WHITE | TB_BOLD, TB_BLACK);
+	printcenteredin("avg ms per run", r.x, r.y + 2, r.w, TB_BLACK | TB_BRIGHT, TB_BLACK);
+
+	cols = (r.w - 4) / 20;
+	for (i = 0; i < LENGTH(collectors); i++) {
+		snprintf(line, sizeof(line), "%-8s %8.3f", collectors[i].name, info->cost[i].avgms);
+		printat(line, r.x + 2 + (i % cols) * 20, r.y + 3 + i / cols,
+		        info->cost[i].avgms >= 10 ? TB_RED : info->cost[i].avgms >= 1 ? TB_YELLOW : TB_CYAN,
+		        TB_BLACK);
+	}
+}
+
 static void
 displayinfo(const SysInfo *info)
 {
-	struct passwd *pw;
-	struct utsname buf;
-	char displayline[MAXSTRLEN];
-	char temp[64];
-	int width, height, memperc, cpuperc, battperc;
+	char displayline[MAXSTRLEN], detail[64];
+	char temp[64], rate[16];
+	int width, height, memperc, memtotal, cpuperc, battperc, cglimited;
 	int hex_width, max_bytes, bytes_per_line;
 	int ascii_box_width, system_box_width, system_box_x;
-	uint16_t memcolor, cpucolor, battcolor;
-	FILE *hostname_fp;
-	char hostname[64];
+	uint16_t memcolor, cpucolor, battcolor, loadcolor;
 	const char **art;
-	uid_t uid;
 
 	width = tb_width();
 	height = tb_height();
@@ -801,26 +2159,8 @@ displayinfo(const SysInfo *info)
 	art = getasciiart(info->systemstr);
 	drawbox(2, 6, ascii_box_width, 12, " OS ", TB_CYAN, TB_BLACK);
 	drawasciiart(art, 2, 6, ascii_box_width, 12, TB_CYAN | TB_BOLD, TB_BLACK);
-	
-	uid = getuid();
-	pw = getpwuid(uid);
-	
-	/* Get system information */
-	if (uname(&buf) != 0) {
-		strcpy(buf.sysname, "Unknown");
-		strcpy(buf.release, "Unknown");
-		strcpy(buf.machine, "Unknown");
-	}
-
-	strcpy(hostname, "Unknown");
-	hostname_fp = fopen("/etc/hostname", "r");
-	if (hostname_fp) {
-		if (fgets(hostname, sizeof(hostname), hostname_fp))
-			hostname[strcspn(hostname, "\n")] = 0;
-		fclose(hostname_fp);
-	}
 
-	drawbox(system_box_x, 6, system_box_width, 8, " SYSTEM ", TB_GREEN, TB_BLACK);
+	drawbox(system_box_x, 6, system_box_width, 12, " SYSTEM ", TB_GREEN, TB_BLACK);
 	snprintf(displayline, MAXSTRLEN, "%s", info->timestr);
 	printcenteredin(displayline, system_box_x, 8, system_box_width, TB_YELLOW, TB_BLACK);
 	snprintf(displayline, MAXSTRLEN, "%s", info->uptimestr);
@@ -828,30 +2168,71 @@ displayinfo(const SysInfo *info)
 	
 	drawseparator(system_box_x + 2, 10, system_box_width - 4, TB_GREEN, TB_BLACK);
 	
-	snprintf(displayline, MAXSTRLEN, "Host: %s@%s", pw ? pw->pw_name : "Unknown", hostname);
+	snprintf(displayline, MAXSTRLEN, "Host: %s@%s", info->host.user, info->host.hostname);
 	printcenteredin(displayline, system_box_x, 11, system_box_width, TB_CYAN, TB_BLACK);
 
-	snprintf(displayline, MAXSTRLEN, "System: %s %s %s", buf.sysname, buf.release, buf.machine);
+	snprintf(displayline, MAXSTRLEN, "System: %s %s %s", info->host.sysname,
+	         info->host.release, info->host.machine);
 	printcenteredin(displayline, system_box_x, 12, system_box_width, TB_CYAN, TB_BLACK);
 
-	drawbox(2, 19, (hex_width - 6) / 2, 9, " RESOURCES ", TB_YELLOW, TB_BLACK);
+	drawseparator(system_box_x + 2, 13, system_box_width - 4, TB_GREEN, TB_BLACK);
+
+	if (info->load[0] >= 0) {
+		snprintf(displayline, MAXSTRLEN, "Load: %.2f %.2f %.2f", info->load[0],
+		         info->load[1], info->load[2]);
+		/* relative to the cores that can run it */
+		loadcolor = info->ncores > 0 && info->load[0] > info->ncores ? TB_RED :
+		            info->ncores > 0 && info->load[0] > info->ncores * 0.7 ? TB_YELLOW : TB_GREEN;
+		printcenteredin(displayline, system_box_x, 14, system_box_width, loadcolor, TB_BLACK);
+	}
+	snprintf(displayline, MAXSTRLEN, "Tasks: %d/%d  Running: %u  Blocked: %u",
+	         info->lrunnable, info->lentities, info->sched.running, info->sched.blocked);
+	printcenteredin(displayline, system_box_x, 15, system_box_width,
+	                info->sched.blocked > 0 ? TB_YELLOW : TB_CYAN, TB_BLACK);
+	fmtscaled(temp, sizeof(temp), info->ctxtps, 1000);
+	fmtscaled(rate, sizeof(rate), info->forkps, 1000);
+	snprintf(displayline, MAXSTRLEN, "Switches: %s/s  Forks: %s/s", temp, rate);
+	printcenteredin(displayline, system_box_x, 16, system_box_width, TB_CYAN, TB_BLACK);
+
+	drawbox(2, 19, (hex_width - 6) / 2, 15, " RESOURCES ", TB_YELLOW, TB_BLACK);
 	
-	if (sscanf(info->memorystr, "%*d MB / %*d MB (%d%%)", &memperc) != 1)
-		memperc = 0;
+	if (sscanf(info->memorystr, "%*d MB / %d MB (%d%%)", &memtotal, &memperc) != 2)
+		memtotal = memperc = 0;
+	/* a cgroup limit only matters when it is tighter than the host */
+	cglimited = info->cg.valid && info->cg.memmax > 0 &&
+	            info->cg.memmax / (1024 * 1024) < (unsigned long long)memtotal;
+	if (cglimited) {
+		memperc = info->cg.memcurrent * 100 / info->cg.memmax;
+		snprintf(detail, sizeof(detail), "%llu MB / %llu MB limit",
+		         info->cg.memcurrent / (1024 * 1024), info->cg.memmax / (1024 * 1024));
+	}
 	memcolor = memperc > 80 ? TB_RED : memperc > 60 ? TB_YELLOW : TB_GREEN;
 	
-	printcenteredin("Memory:", 2, 21, (hex_width - 6) / 2, TB_WHITE | TB_BOLD, TB_BLACK);
+	printcenteredin(cglimited ? "Memory (cgroup):" : "Memory:", 2, 21, (hex_width - 6) / 2,
+	                TB_WHITE | TB_BOLD, TB_BLACK);
 	snprintf(temp, sizeof(temp), "%d%%", memperc);
 	printcenteredin(temp, 2, 22, (hex_width - 6) / 2, memcolor, TB_BLACK);
-	printcenteredin(info->memorystr, 2, 23, (hex_width - 6) / 2, TB_BLUE, TB_BLACK);
+	printcenteredin(cglimited ? detail : info->memorystr, 2, 23, (hex_width - 6) / 2,
+	                TB_BLUE, TB_BLACK);
+	drawmemdetail(info, 2, 24, (hex_width - 6) / 2);
 
 	if (sscanf(info->cpustr, "%d%%", &cpuperc) != 1)
 		cpuperc = 0;
+	cglimited = info->cg.valid && info->cg.cpulimit > 0 && info->cg.cpulimit < info->ncores;
+	if (cglimited) {
+		cpuperc = info->cg.cpuused * 100 / info->cg.cpulimit;
+		snprintf(detail, sizeof(detail), "%.2f of %.2f CPUs", info->cg.cpuused,
+		         info->cg.cpulimit);
+		printcenteredin(detail, 2, 30, (hex_width - 6) / 2, TB_BLUE, TB_BLACK);
+	}
 	cpucolor = cpuperc > 80 ? TB_RED : cpuperc > 60 ? TB_YELLOW : TB_GREEN;
 	
-	printcenteredin("CPU:", 2, 25, (hex_width - 6) / 2, TB_WHITE | TB_BOLD, TB_BLACK);
+	printcenteredin(cglimited ? "CPU (cgroup):" : "CPU:", 2, 28, (hex_width - 6) / 2,
+	                TB_WHITE | TB_BOLD, TB_BLACK);
 	snprintf(temp, sizeof(temp), "%d%%", cpuperc);
-	printcenteredin(temp, 2, 26, (hex_width - 6) / 2, cpucolor, TB_BLACK);
+	printcenteredin(temp, 2, 29, (hex_width - 6) / 2, cpucolor, TB_BLACK);
+	if (info->ncores > 0)
+		drawcpubar(info, 4, 31, (hex_width - 6) / 2 - 4);
 
 	drawbox(2 + (hex_width - 6) / 2 + 2, 19, (hex_width - 6) / 2, 15, " CONNECTIVITY ", TB_BLUE, TB_BLACK);
 	
@@ -889,22 +2270,252 @@ displayinfo(const SysInfo *info)
 		printcenteredin("No battery detected", 2, 38, hex_width - 4, TB_CYAN, TB_BLACK);
 	}
 
+	layoutpanels(width, height, hex_width);
+	drawcores(info);
+	drawnuma(info);
+	drawirqs(info);
+	drawtraffic(info);
+	drawdisks(info);
+	drawfs(info);
+	drawpsi(info);
+	drawprocs(info);
+	drawcgroups(info);
+	drawsensors(info);
+	drawoverhead(info);
+
 	/* Create a footer box */
 	drawbox(2, height - 4, hex_width - 4, 3, "", TB_WHITE, TB_BLACK);
-	snprintf(displayline, MAXSTRLEN, "'q' Quit  *  'r' Reboot  *  's' Shutdown  *  Refreshes every %ds", refresh_interval);
-	printcenteredin(displayline, 2, height - 2, hex_width - 4,
+	/* each collector keeps its own period, so there is no one refresh rate to show */
+	printcenteredin("'q' Quit  *  'r' Reboot  *  's' Shutdown", 2, height - 2, hex_width - 4,
 	              TB_WHITE | TB_BOLD, TB_BLACK);
 
 	tb_present();
 }
 
+static int
+handleevent(const struct tb_event *ev, const SysInfo *info)
+{
+	int ret_code;
+
+	if (ev->type == TB_EVENT_KEY) {
+		if (ev->ch == 'q' || ev->key == TB_KEY_ESC) {
+			return 1;
+		} else if (ev->ch == 'r') {
+			tb_shutdown();
+			printf("Rebooting system...\n");
+			fflush(stdout);
+			ret_code = system(reboot_cmd);
+			if (ret_code != 0) {
+				printf("Reboot command failed with exit code: %d\n", ret_code);
+				printf("Command was: %s\n", reboot_cmd);
+				exit(1);
+			}
+			exit(0);
+		} else if (ev->ch == 's') {
+			tb_shutdown();
+			printf("Shutting down system...\n");
+			fflush(stdout);
+			ret_code = system(shutdown_cmd);
+			if (ret_code != 0) {
+				printf("Shutdown command failed with exit code: %d\n", ret_code);
+				printf("Command was: %s\n", shutdown_cmd);
+				exit(1);
+			}
+			exit(0);
+		} else {
+			/* Debug: log unhandled keys */
+			// Uncomment for debugging: printf("Unhandled key: ch=%c (%d), key=%d\n", ev->ch, ev->ch, ev->key);
+		}
+	} else if (ev->type == TB_EVENT_RESIZE) {
+		displayinfo(info);
+	}
+	return 0;
+}
+
+/*
+ * Seqlock writer: the count is odd while the copy is in progress, so a
+ * reader that sees it change or odd knows its copy is torn and retries.
+ * Only the collector thread writes, readers never block it.
+ */
+static void
+publish(const SysInfo *info)
+{
+	unsigned int seq;
+	char c;
+
+	seq = __atomic_load_n(&shareseq, __ATOMIC_RELAXED);
+	__atomic_store_n(&shareseq, seq + 1, __ATOMIC_RELAXED);
+	__atomic_thread_fence(__ATOMIC_RELEASE);
+	memcpy(&shared, info, sizeof(shared));
+	__atomic_store_n(&shareseq, seq + 2, __ATOMIC_RELEASE);
+
+	/* a full pipe already has a wakeup pending */
+	c = 0;
+	if (write(notifypipe[1], &c, 1) < 0 && errno != EAGAIN)
+		return;
+}
+
+static void
+snapshot(SysInfo *info)
+{
+	unsigned int seq0, seq1;
+
+	do {
+		seq0 = __atomic_load_n(&shareseq, __ATOMIC_ACQUIRE);
+		memcpy(info, &shared, sizeof(*info));
+		__atomic_thread_fence(__ATOMIC_ACQUIRE);
+		seq1 = __atomic_load_n(&shareseq, __ATOMIC_RELAXED);
+	} while (seq0 != seq1 || (seq0 & 1));
+}
+
+/* runs every collector on its schedule and publishes each new SysInfo */
+static void *
+collectorloop(void *arg)
+{
+	static SysInfo info;
+	Sched sched;
+	SchedEntry e;
+	struct pollfd pfd[CFdLast];
+	unsigned char due[LENGTH(collectors)];
+	double t, period, wait;
+	unsigned int changed;
+	size_t i;
+	int ret, dirty;
+
+	(void)arg;
+
+	for (i = 0; i < CFdLast; i++) {
+		pfd[i].fd = -1;
+		pfd[i].events = POLLIN;
+	}
+	pfd[CFdNetlink].fd = nlevfd = nlsubscribe();
+	if ((pfd[CFdWatch].fd = watchfd = watchinit()) >= 0)
+		for (i = 0; i < LENGTH(watched); i++)
+			watchfile(watched[i].pf->path, i);
+	/* mountinfo signals a changed mount table with POLLPRI, once it is open */
+	pfread(&pfmountinfo);
+	pfd[CFdMounts].fd = mountfd = pfmountinfo.fd;
+	pfd[CFdMounts].events = POLLPRI;
+	/* PSI triggers wake us within the window instead of the next refresh */
+	for (i = 0; i < PsiLast; i++) {
+		pfd[CFdPsi + i].fd = psifd[i] = psitrigger(pfpsi[i].path, psi_stall_us, psi_window_us);
+		pfd[CFdPsi + i].events = POLLPRI;
+	}
+
+	collectsysteminfo(&info);
+	publish(&info);
+
+	/* every collector runs on its own period; on-change ones stay out */
+	sched.n = 0;
+	t = now();
+	for (i = 0; i < LENGTH(collectors); i++) {
+		if (*collectors[i].period > 0)
+			schedpush(&sched, i, t + *collectors[i].period);
+		else if (!collectors[i].evfd || *collectors[i].evfd < 0)
+			schedpush(&sched, i, t + refresh_interval);
+	}
+
+	/*
+	 * Each pass sleeps until the next deadline or a kernel event, marks
+	 * every collector that either made due, then runs each of those
+	 * once: a PSI trigger, an inotify change and an expired deadline
+	 * landing in the same wake cost one run, not three.
+	 */
+	for (;;) {
+		/* collectfs() may have closed or reopened mountinfo */
+		pfd[CFdMounts].fd = mountfd;
+
+		wait = schednext(&sched) - now();
+		if (poll(pfd, CFdLast, wait > 0 ? (int)(wait * 1000) + 1 : 0) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		memset(due, 0, sizeof(due));
+		t = now();
+		while (schednext(&sched) >= 0 && schednext(&sched) <= t) {
+			schedpop(&sched, &e);
+			due[e.id] = 1;
+			period = *collectors[e.id].period;
+			/* on-change collectors are only scheduled as a fallback */
+			if (period <= 0)
+				period = refresh_interval;
+			/* stay on the original cadence, but never queue up missed runs */
+			e.deadline += period;
+			if (e.deadline <= t)
+				e.deadline = t + period;
+			schedpush(&sched, e.id, e.deadline);
+		}
+
+		if (pfd[CFdNetlink].revents) {
+			/* on a broken subscription fall back to polling, unless it already polls */
+			if ((ret = nlevents()) < 0) {
+				pfd[CFdNetlink].fd = nlevfd = -1;
+				if (net_period <= 0 && !schedhas(&sched, CollNet))
+					schedpush(&sched, CollNet, now() + refresh_interval);
+			}
+			if (ret != 0) {
+				netdevs.relinked = 1;
+				due[CollNet] = 1;
+			}
+		}
+
+		if (pfd[CFdMounts].revents & POLLNVAL) {
+			pfclose(&pfmountinfo);
+			mountfd = -1;
+		} else if (pfd[CFdMounts].revents) {
+			mountsdirty = 1;
+			due[CollFs] = 1;
+		}
+
+		for (i = 0; i < PsiLast; i++) {
+			if (!pfd[CFdPsi + i].revents)
+				continue;
+			if (pfd[CFdPsi + i].revents & (POLLERR | POLLNVAL)) {
+				close(psifd[i]);
+				pfd[CFdPsi + i].fd = psifd[i] = -1;
+				continue;
+			}
+			psifired[i] = t;
+			due[CollPsi] = 1;
+		}
+
+		if (pfd[CFdWatch].revents) {
+			/* reopen replaced files so the new inode is read */
+			changed = watchevents();
+			for (i = 0; i < LENGTH(watched); i++) {
+				if (!(changed & (1u << i)))
+					continue;
+				pfclose(watched[i].pf);
+				due[watched[i].coll] = 1;
+			}
+		}
+
+		dirty = 0;
+		for (i = 0; i < LENGTH(collectors); i++) {
+			if (!due[i])
+				continue;
+			runcollector(i, &info);
+			dirty = 1;
+		}
+		if (dirty)
+			publish(&info);
+	}
+	return NULL;
+}
+
 int
 main(int argc, char *argv[])
 {
-	SysInfo info;
+	static SysInfo info;
 	struct tb_event ev;
-	struct timeval lastupdate, lasthexupdate, currenttime;
-	int ret;
+	struct pollfd pfd[FdLast];
+	pthread_t collector;
+	struct rlimit rl;
+	double next, wait;
+	char drain[64];
+	int i, ret, quit;
 
 	argv0 = argv[0];
 
@@ -913,71 +2524,72 @@ main(int argc, char *argv[])
 
 	setlocale(LC_ALL, "");
 
+	if (pipe(notifypipe) < 0)
+		die("pipe() failed");
+	for (i = 0; i < 2; i++) {
+		fcntl(notifypipe[i], F_SETFL, O_NONBLOCK);
+		fcntl(notifypipe[i], F_SETFD, FD_CLOEXEC);
+	}
+
 	ret = tb_init();
 	if (ret)
 		die("tb_init() failed");
 
 	tb_set_input_mode(TB_INPUT_ESC);
 
-	gettimeofday(&lastupdate, NULL);
-	gettimeofday(&lasthexupdate, NULL);
+	for (i = 0; i < FdLast; i++) {
+		pfd[i].fd = -1;
+		pfd[i].events = POLLIN;
+	}
+	tb_get_fds(&pfd[FdTty].fd, &pfd[FdResize].fd);
+	pfd[FdNotify].fd = notifypipe[0];
 
-	for (;;) {
-		gettimeofday(&currenttime, NULL);
+	/* one held fd per sysfs and /proc file can go past the default soft limit */
+	if (getrlimit(RLIMIT_NOFILE, &rl) == 0 && rl.rlim_cur < rl.rlim_max) {
+		rl.rlim_cur = rl.rlim_max;
+		setrlimit(RLIMIT_NOFILE, &rl);
+	}
+
+	/* collection runs on its own thread so input is never held up by it */
+	if (pthread_create(&collector, NULL, collectorloop, NULL) != 0) {
+		tb_shutdown();
+		die("pthread_create() failed");
+	}
 
-		double elapsed_update = (currenttime.tv_sec - lastupdate.tv_sec) + 
-		                       (currenttime.tv_usec - lastupdate.tv_usec) / 1000000.0;
-		double elapsed_hex = (currenttime.tv_sec - lasthexupdate.tv_sec) + 
-		                    (currenttime.tv_usec - lasthexupdate.tv_usec) / 1000000.0;
+	displayinfo(&info);
+	next = now() + hex_refresh_interval;
 
-		if (elapsed_update >= refresh_interval) {
-			collectsysteminfo(&info);
+	for (quit = 0; !quit;) {
+		wait = next - now();
+		if (wait <= 0) {
 			displayinfo(&info);
-			lastupdate = currenttime;
-			lasthexupdate = currenttime;
-		} else if (elapsed_hex >= hex_refresh_interval) {
+			next += hex_refresh_interval;
+			if (next <= now())
+				next = now() + hex_refresh_interval;
+			continue;
+		}
+
+		if (poll(pfd, FdLast, (int)(wait * 1000) + 1) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+
+		if (pfd[FdNotify].revents) {
+			while (read(notifypipe[0], drain, sizeof(drain)) > 0)
+				;
+			snapshot(&info);
 			displayinfo(&info);
-			lasthexupdate = currenttime;
-		}
-
-		ret = tb_peek_event(&ev, 100);
-
-		if (ret == TB_OK) {
-			if (ev.type == TB_EVENT_KEY) {
-				if (ev.ch == 'q' || ev.key == TB_KEY_ESC) {
-					break;
-				} else if (ev.ch == 'r') {
-					tb_shutdown();
-					printf("Rebooting system...\n");
-					fflush(stdout);
-					int ret_code = system(reboot_cmd);
-					if (ret_code != 0) {
-						printf("Reboot command failed with exit code: %d\n", ret_code);
-						printf("Command was: %s\n", reboot_cmd);
-						exit(1);
-					}
-					return 0;
-				} else if (ev.ch == 's') {
-					tb_shutdown();
-					printf("Shutting down system...\n");
-					fflush(stdout);
-					int ret_code = system(shutdown_cmd);
-					if (ret_code != 0) {
-						printf("Shutdown command failed with exit code: %d\n", ret_code);
-						printf("Command was: %s\n", shutdown_cmd);
-						exit(1);
-					}
-					return 0;
-				} else {
-					/* Debug: log unhandled keys */
-					// Uncomment for debugging: printf("Unhandled key: ch=%c (%d), key=%d\n", ev.ch, ev.ch, ev.key);
-				}
-			} else if (ev.type == TB_EVENT_RESIZE) {
-				displayinfo(&info);
-			}
+			next = now() + hex_refresh_interval;
+		}
+
+		if (pfd[FdTty].revents || pfd[FdResize].revents) {
+			while (!quit && tb_peek_event(&ev, 0) == TB_OK)
+				quit = handleevent(&ev, &info);
 		}
 	}
 
+	/* the collector may be stuck in a slow probe, so it is not joined */
 	tb_shutdown();
 	return 0;
 }
@@ -0,0 +1,122 @@
+/* See LICENSE file for copyright and license details. */
+/* single-pass /proc/meminfo and /proc/vmstat parsers */
+
+#include <stddef.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "mem.h"
+
+#define KEY(k, s, f) { k, sizeof(k) - 1, offsetof(s, f) }
+
+typedef struct {
+	const char *key;
+	size_t len;
+	size_t off;
+} Key;
+
+static void parsekeys(const char *buf, int sep, const Key *keys, size_t nkeys, void *out);
+
+/* in the order the kernel prints them, so the expected key usually matches */
+static const Key memkeys[] = {
+	KEY("MemTotal",        MemInfo, memtotal),
+	KEY("MemFree",         MemInfo, memfree),
+	KEY("MemAvailable",    MemInfo, memavailable),
+	KEY("Buffers",         MemInfo, buffers),
+	KEY("Cached",          MemInfo, cached),
+	KEY("SwapCached",      MemInfo, swapcached),
+	KEY("SwapTotal",       MemInfo, swaptotal),
+	KEY("SwapFree",        MemInfo, swapfree),
+	KEY("Zswap",           MemInfo, zswap),
+	KEY("Zswapped",        MemInfo, zswapped),
+	KEY("Dirty",           MemInfo, dirty),
+	KEY("Writeback",       MemInfo, writeback),
+	KEY("Slab",            MemInfo, slab),
+	KEY("SReclaimable",    MemInfo, sreclaimable),
+	KEY("SUnreclaim",      MemInfo, sunreclaim),
+	KEY("AnonHugePages",   MemInfo, anonhugepages),
+	KEY("HugePages_Total", MemInfo, hugepagestotal),
+	KEY("HugePages_Free",  MemInfo, hugepagesfree),
+	KEY("HugePages_Rsvd",  MemInfo, hugepagesrsvd),
+	KEY("HugePages_Surp",  MemInfo, hugepagessurp),
+	KEY("Hugepagesize",    MemInfo, hugepagesize),
+};
+
+static const Key vmkeys[] = {
+	KEY("pswpin",     VmStat, pswpin),
+	KEY("pswpout",    VmStat, pswpout),
+	KEY("zswpin",     VmStat, zswpin),
+	KEY("zswpout",    VmStat, zswpout),
+};
+
+#define LEN(a) (sizeof(a) / sizeof((a)[0]))
+
+/*
+ * Walk the buffer once: measure each key up to sep, match it by
+ * length and bytes against the table, then accumulate the digits in
+ * place. No sscanf, no copies, no allocation.
+ */
+static void
+parsekeys(const char *buf, int sep, const Key *keys, size_t nkeys, void *out)
+{
+	const char *p, *key;
+	unsigned long long v;
+	size_t len, k, next;
+
+	next = 0;
+	for (p = buf; *p;) {
+		key = p;
+		while (*p && *p != sep && *p != '\n')
+			p++;
+		len = p - key;
+		if (*p != sep) {
+			if (*p)
+				p++;
+			continue;
+		}
+
+		k = next;
+		if (k >= nkeys || keys[k].len != len || memcmp(keys[k].key, key, len) != 0) {
+			for (k = 0; k < nkeys; k++)
+				if (keys[k].len == len && memcmp(keys[k].key, key, len) == 0)
+					break;
+		}
+
+		if (k < nkeys) {
+			for (p++; *p == ' '; p++)
+				;
+			for (v = 0; (unsigned)(*p - '0') < 10; p++)
+				v = v * 10 + (*p - '0');
+			*(unsigned long long *)((char *)out + keys[k].off) = v;
+			next = k + 1;
+		}
+		if (!(p = strchr(p, '\n')))
+			break;
+		p++;
+	}
+}
+
+void
+parsememinfo(const char *buf, MemInfo *mi)
+{
+	memset(mi, 0, sizeof(*mi));
+	parsekeys(buf, ':', memkeys, LEN(memkeys), mi);
+}
+
+/* vmstat is "key value" and mostly keys nobody asked for */
+void
+parsevmstat(const char *buf, VmStat *vs)
+{
+	memset(vs, 0, sizeof(*vs));
+	parsekeys(buf, ' ', vmkeys, LEN(vmkeys), vs);
+}
+
+/* the first three fields of a zram device's mm_stat */
+int
+parsezram(const char *buf, ZramStat *zs)
+{
+	memset(zs, 0, sizeof(*zs));
+	if (sscanf(buf, "%llu %llu %llu", &zs->orig, &zs->compr, &zs->used) != 3)
+		return -1;
+	return 0;
+}
@@ -0,0 +1,28 @@
+/* See LICENSE file for copyright and license details. */
+
+/* /proc/meminfo fields, in kB except the HugePages_ page counts */
+typedef struct {
+	unsigned long long memtotal, memfree, memavailable, buffers, cached;
+	unsigned long long swapcached, swaptotal, swapfree, zswap, zswapped;
+	unsigned long long dirty, writeback, slab, sreclaimable, sunreclaim;
+	unsigned long long anonhugepages;
+	unsigned long long hugepagestotal, hugepagesfree, hugepagesrsvd;
+	unsigned long long hugepagessurp, hugepagesize;
+} MemInfo;
+
+/* /proc/vmstat event counters, in pages or events since boot */
+typedef struct {
+	unsigned long long pswpin, pswpout;
+	unsigned long long zswpin, zswpout;
+} VmStat;
+
+/* /sys/block/zramN/mm_stat, in bytes */
+typedef struct {
+	unsigned long long orig;    /* data stored, uncompressed */
+	unsigned long long compr;   /* the same, compressed */
+	unsigned long long used;    /* memory the pool takes, overhead included */
+} ZramStat;
+
+void parsememinfo(const char *buf, MemInfo *mi);
+void parsevmstat(const char *buf, VmStat *vs);
+int parsezram(const char *buf, ZramStat *zs);
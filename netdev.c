@@ -0,0 +1,120 @@
+/* See LICENSE file for copyright and license details. */
+/* per-interface throughput from IFLA_STATS64 */
+
+#include <string.h>
+
+#include "hash.h"
+#include "netdev.h"
+#include "netlink.h"
+
+static NetDev *lookup(NetDevTable *t, int index);
+static double rate(const void *d);
+static void update(void *arg, int index, unsigned int flags, const char *name,
+                   const struct rtnl_link_stats64 *st);
+
+/* find the slot for index, claiming a free one if it is new */
+static NetDev *
+lookup(NetDevTable *t, int index)
+{
+	NetDev *d;
+
+	d = &t->slots[hashfind(t->slots, sizeof(*d), NETDEVMAX, index)];
+	if (d->index)
+		return d;
+	if (t->n >= NETDEVMAX / 4 * 3)
+		return NULL;
+	t->n++;
+	memset(d, 0, sizeof(*d));
+	d->index = index;
+	return d;
+}
+
+static double
+rate(const void *d)
+{
+	return ((const NetDev *)d)->rxbps + ((const NetDev *)d)->txbps;
+}
+
+static void
+update(void *arg, int index, unsigned int flags, const char *name,
+       const struct rtnl_link_stats64 *st)
+{
+	NetDevTable *t = arg;
+	NetDev *d;
+	unsigned long long errors, drops;
+	int renamed;
+
+	if ((flags & IFF_LOOPBACK) || !(d = lookup(t, index)))
+		return;
+
+	errors = st->rx_errors + st->tx_errors;
+	drops = st->rx_dropped + st->tx_dropped;
+
+	/*
+	 * a new link, a reused ifindex or reset counters start over; a name
+	 * only changes along with a link event, so only then is it compared
+	 */
+	renamed = t->relinked && strcmp(d->name, name);
+	d->valid = d->gen && t->dt > 0 && !renamed &&
+	           st->rx_bytes >= d->rxbytes && st->tx_bytes >= d->txbytes &&
+	           st->rx_packets >= d->rxpackets && st->tx_packets >= d->txpackets &&
+	           errors >= d->errors && drops >= d->drops;
+	if (d->valid) {
+		d->rxbps = (st->rx_bytes - d->rxbytes) / t->dt;
+		d->txbps = (st->tx_bytes - d->txbytes) / t->dt;
+		d->rxpps = (st->rx_packets - d->rxpackets) / t->dt;
+		d->txpps = (st->tx_packets - d->txpackets) / t->dt;
+		d->errps = (errors - d->errors) / t->dt;
+		d->dropps = (drops - d->drops) / t->dt;
+	} else {
+		d->rxbps = d->txbps = d->rxpps = d->txpps = d->errps = d->dropps = 0;
+		strncpy(d->name, name, sizeof(d->name) - 1);
+	}
+
+	d->rxbytes = st->rx_bytes;
+	d->txbytes = st->tx_bytes;
+	d->rxpackets = st->rx_packets;
+	d->txpackets = st->tx_packets;
+	d->errors = errors;
+	d->drops = drops;
+	d->gen = t->gen;
+}
+
+int
+netdevsample(NetDevTable *t, double now)
+{
+	unsigned int i;
+
+	t->dt = t->last > 0 ? now - t->last : 0;
+	t->last = now;
+	if (++t->gen == 0)
+		t->gen = 1;
+
+	if (nlstats(update, t) < 0)
+		return -1;
+	t->relinked = 0;
+
+	/* links that were not in this dump are gone */
+	for (i = 0; i < NETDEVMAX;) {
+		if (t->slots[i].index && t->slots[i].gen != t->gen) {
+			hashdel(t->slots, sizeof(t->slots[0]), NETDEVMAX, i); /* may shift another entry into i */
+			t->n--;
+		} else {
+			i++;
+		}
+	}
+	return 0;
+}
+
+/* the n busiest links by total bytes/s, busiest first */
+int
+netdevtop(const NetDevTable *t, NetDev *top, int n)
+{
+	int i, count;
+
+	count = 0;
+	for (i = 0; i < NETDEVMAX; i++)
+		if (t->slots[i].index)
+			count = topinsert(top, sizeof(*top), count, n, &t->slots[i], rate);
+	return count;
+}
@@ -0,0 +1,28 @@
+/* See LICENSE file for copyright and license details. */
+
+#include <net/if.h>
+
+#define NETDEVMAX 4096 /* power of two, kept at most 3/4 full */
+
+typedef struct {
+	int index;               /* ifindex, 0 marks a free slot */
+	unsigned int gen;        /* last sample the link was seen in */
+	int valid;               /* rates cover a full interval */
+	char name[IF_NAMESIZE];
+	unsigned long long rxbytes, txbytes, rxpackets, txpackets;
+	unsigned long long errors, drops;
+	double rxbps, txbps, rxpps, txpps, errps, dropps;
+} NetDev;
+
+/* open-addressed table of links keyed by ifindex */
+typedef struct {
+	NetDev slots[NETDEVMAX];
+	int n;
+	unsigned int gen;
+	int relinked;            /* a link event came in, names may have changed */
+	double last;
+	double dt;
+} NetDevTable;
+
+int netdevsample(NetDevTable *t, double now);
+int netdevtop(const NetDevTable *t, NetDev *top, int n);
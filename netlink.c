@@ -0,0 +1,394 @@
+/* See LICENSE file for copyright and license details. */
+/* rtnetlink route, address and link queries */
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include "netlink.h"
+
+#define NLBUFSIZ 32768
+
+typedef void (*NlHandler)(void *arg, struct nlmsghdr *nh);
+
+typedef struct {
+	NlStatsFn fn;
+	void *arg;
+} StatsArg;
+
+static int dump(void *arg, int type, NlHandler handler);
+static int growlinks(void);
+static NlLink *findlink(NlState *st, int index);
+static void handlelink(void *arg, struct nlmsghdr *nh);
+static void handleaddr(void *arg, struct nlmsghdr *nh);
+static void handleroute(void *arg, struct nlmsghdr *nh);
+static void handlestats(void *arg, struct nlmsghdr *nh);
+static int isvpnname(const char *name);
+
+static int nlfd = -1;
+static int nlevfd = -1;
+static unsigned int nlseq;
+static char nlbuf[NLBUFSIZ] __attribute__((aligned(NLMSG_ALIGNTO)));
+
+/* state private to one nlquery() pass, the link arrays only ever grow */
+static NlLink *links;
+static char (*linkaddr)[NLADDRLEN];
+static int linkcap;
+static unsigned int gwprio;
+static int gwoif;
+
+int
+nlopen(void)
+{
+	struct sockaddr_nl sa;
+
+	if (nlfd >= 0)
+		return 0;
+	if ((nlfd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC, NETLINK_ROUTE)) < 0)
+		return -1;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.nl_family = AF_NETLINK;
+	if (bind(nlfd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+		nlclose();
+		return -1;
+	}
+	return 0;
+}
+
+void
+nlclose(void)
+{
+	if (nlfd >= 0)
+		close(nlfd);
+	nlfd = -1;
+}
+
+int
+nlsubscribe(void)
+{
+	struct sockaddr_nl sa;
+
+	if (nlevfd >= 0)
+		return nlevfd;
+	if ((nlevfd = socket(AF_NETLINK, SOCK_RAW | SOCK_CLOEXEC | SOCK_NONBLOCK,
+	                     NETLINK_ROUTE)) < 0)
+		return -1;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.nl_family = AF_NETLINK;
+	sa.nl_groups = RTMGRP_LINK | RTMGRP_IPV4_IFADDR | RTMGRP_IPV6_IFADDR |
+	               RTMGRP_IPV4_ROUTE;
+	if (bind(nlevfd, (struct sockaddr *)&sa, sizeof(sa)) < 0) {
+		close(nlevfd);
+		nlevfd = -1;
+	}
+	return nlevfd;
+}
+
+int
+nlevents(void)
+{
+	struct nlmsghdr *nh;
+	ssize_t len;
+	int changed;
+
+	changed = 0;
+	for (;;) {
+		if ((len = recv(nlevfd, nlbuf, sizeof(nlbuf), 0)) < 0) {
+			if (errno == EINTR)
+				continue;
+			/* an overrun lost notifications, so assume everything changed */
+			if (errno == ENOBUFS) {
+				changed = 1;
+				continue;
+			}
+			if (errno == EAGAIN || errno == EWOULDBLOCK)
+				return changed;
+			return -1;
+		}
+		for (nh = (struct nlmsghdr *)nlbuf; NLMSG_OK(nh, (size_t)len); nh = NLMSG_NEXT(nh, len)) {
+			switch (nh->nlmsg_type) {
+			case RTM_NEWLINK: case RTM_DELLINK:
+			case RTM_NEWADDR: case RTM_DELADDR:
+			case RTM_NEWROUTE: case RTM_DELROUTE:
+				changed = 1;
+				break;
+			}
+		}
+	}
+}
+
+static int
+dump(void *arg, int type, NlHandler handler)
+{
+	struct {
+		struct nlmsghdr nh;
+		struct rtgenmsg g;
+	} req;
+	struct sockaddr_nl sa;
+	struct nlmsghdr *nh;
+	ssize_t len;
+	unsigned int seq;
+
+	memset(&req, 0, sizeof(req));
+	req.nh.nlmsg_len = NLMSG_LENGTH(sizeof(req.g));
+	req.nh.nlmsg_type = type;
+	req.nh.nlmsg_flags = NLM_F_REQUEST | NLM_F_DUMP;
+	req.nh.nlmsg_seq = seq = ++nlseq;
+	req.g.rtgen_family = type == RTM_GETROUTE ? AF_INET : AF_UNSPEC;
+
+	memset(&sa, 0, sizeof(sa));
+	sa.nl_family = AF_NETLINK;
+	if (sendto(nlfd, &req, req.nh.nlmsg_len, 0, (struct sockaddr *)&sa, sizeof(sa)) < 0)
+		return -1;
+
+	for (;;) {
+		if ((len = recv(nlfd, nlbuf, sizeof(nlbuf), 0)) < 0) {
+			if (errno == EINTR)
+				continue;
+			return -1;
+		}
+		for (nh = (struct nlmsghdr *)nlbuf; NLMSG_OK(nh, (size_t)len); nh = NLMSG_NEXT(nh, len)) {
+			if (nh->nlmsg_seq != seq)
+				continue;
+			if (nh->nlmsg_type == NLMSG_DONE)
+				return 0;
+			if (nh->nlmsg_type == NLMSG_ERROR)
+				return -1;
+			handler(arg, nh);
+		}
+	}
+}
+
+static int
+growlinks(void)
+{
+	void *q;
+	int cap;
+
+	cap = linkcap ? linkcap * 2 : 64;
+	if (!(q = realloc(links, cap * sizeof(*links))))
+		return -1;
+	links = q;
+	if (!(q = realloc(linkaddr, cap * sizeof(*linkaddr))))
+		return -1;
+	linkaddr = q;
+	linkcap = cap;
+	return 0;
+}
+
+static NlLink *
+findlink(NlState *st, int index)
+{
+	int i;
+
+	for (i = 0; i < st->nlinks; i++)
+		if (st->links[i].index == index)
+			return &st->links[i];
+	return NULL;
+}
+
+static void
+handlelink(void *arg, struct nlmsghdr *nh)
+{
+	NlState *st = arg;
+	struct ifinfomsg *ifi;
+	struct rtattr *rta;
+	NlLink *l;
+	int len;
+
+	if (nh->nlmsg_type != RTM_NEWLINK)
+		return;
+	if (st->nlinks >= linkcap && growlinks() < 0)
+		return;
+	st->links = links;
+
+	ifi = NLMSG_DATA(nh);
+	l = &st->links[st->nlinks];
+	memset(l, 0, sizeof(*l));
+	l->index = ifi->ifi_index;
+	l->flags = ifi->ifi_flags;
+
+	len = IFLA_PAYLOAD(nh);
+	for (rta = IFLA_RTA(ifi); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		if (rta->rta_type == IFLA_IFNAME) {
+			strncpy(l->name, RTA_DATA(rta), sizeof(l->name) - 1);
+			break;
+		}
+	}
+	linkaddr[st->nlinks][0] = '\0';
+	st->nlinks++;
+}
+
+static void
+handleaddr(void *arg, struct nlmsghdr *nh)
+{
+	NlState *st = arg;
+	struct ifaddrmsg *ifa;
+	struct rtattr *rta;
+	NlLink *l;
+	void *addr;
+	char *dst;
+	int len;
+
+	if (nh->nlmsg_type != RTM_NEWADDR)
+		return;
+
+	ifa = NLMSG_DATA(nh);
+	if (ifa->ifa_family != AF_INET && ifa->ifa_family != AF_INET6)
+		return;
+	if (!(l = findlink(st, ifa->ifa_index)))
+		return;
+	l->hasaddr = 1;
+
+	if (ifa->ifa_family != AF_INET || ifa->ifa_scope == RT_SCOPE_HOST)
+		return;
+
+	addr = NULL;
+	len = IFA_PAYLOAD(nh);
+	for (rta = IFA_RTA(ifa); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		if (rta->rta_type == IFA_LOCAL)
+			addr = RTA_DATA(rta);
+		else if (rta->rta_type == IFA_ADDRESS && !addr)
+			addr = RTA_DATA(rta);
+	}
+	if (!addr)
+		return;
+
+	/* first address per link, and the first overall as a fallback */
+	dst = linkaddr[l - st->links];
+	if (!dst[0])
+		inet_ntop(AF_INET, addr, dst, NLADDRLEN);
+	if (!st->ipaddr[0])
+		inet_ntop(AF_INET, addr, st->ipaddr, sizeof(st->ipaddr));
+}
+
+static void
+handleroute(void *arg, struct nlmsghdr *nh)
+{
+	NlState *st = arg;
+	struct rtmsg *rtm;
+	struct rtattr *rta;
+	NlLink *l;
+	void *gw, *prefsrc;
+	unsigned int table, prio;
+	int len, oif;
+
+	if (nh->nlmsg_type != RTM_NEWROUTE)
+		return;
+
+	rtm = NLMSG_DATA(nh);
+	if (rtm->rtm_family != AF_INET)
+		return;
+
+	gw = prefsrc = NULL;
+	table = rtm->rtm_table;
+	prio = oif = 0;
+	len = RTM_PAYLOAD(nh);
+	for (rta = RTM_RTA(rtm); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		switch (rta->rta_type) {
+		case RTA_TABLE:    table = *(unsigned int *)RTA_DATA(rta); break;
+		case RTA_OIF:      oif = *(int *)RTA_DATA(rta); break;
+		case RTA_PRIORITY: prio = *(unsigned int *)RTA_DATA(rta); break;
+		case RTA_GATEWAY:  gw = RTA_DATA(rta); break;
+		case RTA_PREFSRC:  prefsrc = RTA_DATA(rta); break;
+		}
+	}
+	if (table != RT_TABLE_MAIN)
+		return;
+
+	if ((l = findlink(st, oif)) && isvpnname(l->name))
+		st->vpn = 1;
+
+	/* lowest-metric default route wins, as the kernel would pick it */
+	if (rtm->rtm_dst_len != 0 || (gwoif && prio >= gwprio))
+		return;
+	gwoif = oif ? oif : -1;
+	gwprio = prio;
+	st->gateway[0] = '\0';
+	if (gw)
+		inet_ntop(AF_INET, gw, st->gateway, sizeof(st->gateway));
+	if (prefsrc)
+		inet_ntop(AF_INET, prefsrc, st->ipaddr, sizeof(st->ipaddr));
+	else if (l && linkaddr[l - st->links][0])
+		strcpy(st->ipaddr, linkaddr[l - st->links]);
+}
+
+static void
+handlestats(void *arg, struct nlmsghdr *nh)
+{
+	StatsArg *sa = arg;
+	struct ifinfomsg *ifi;
+	struct rtattr *rta;
+	struct rtnl_link_stats64 stats;
+	const char *name;
+	int len, found;
+
+	if (nh->nlmsg_type != RTM_NEWLINK)
+		return;
+
+	ifi = NLMSG_DATA(nh);
+	name = NULL;
+	found = 0;
+	len = IFLA_PAYLOAD(nh);
+	for (rta = IFLA_RTA(ifi); RTA_OK(rta, len); rta = RTA_NEXT(rta, len)) {
+		if (rta->rta_type == IFLA_IFNAME) {
+			name = RTA_DATA(rta);
+		} else if (rta->rta_type == IFLA_STATS64 && RTA_PAYLOAD(rta) >= sizeof(stats)) {
+			/* attributes are only 4-byte aligned */
+			memcpy(&stats, RTA_DATA(rta), sizeof(stats));
+			found = 1;
+		}
+	}
+	if (name && found)
+		sa->fn(sa->arg, ifi->ifi_index, ifi->ifi_flags, name, &stats);
+}
+
+static int
+isvpnname(const char *name)
+{
+	return strstr(name, "tun") || strstr(name, "tap") || strstr(name, "vpn");
+}
+
+int
+nlquery(NlState *st)
+{
+	memset(st, 0, sizeof(*st));
+	st->links = links;
+	gwprio = 0;
+	gwoif = 0;
+
+	if (nlopen() < 0)
+		return -1;
+	if (dump(st, RTM_GETLINK, handlelink) < 0 ||
+	    dump(st, RTM_GETADDR, handleaddr) < 0 ||
+	    dump(st, RTM_GETROUTE, handleroute) < 0) {
+		/* drop the socket so a half-read dump cannot leak into the next query */
+		nlclose();
+		return -1;
+	}
+	return 0;
+}
+
+/* one RTM_GETLINK dump, handing every link's 64-bit counters to fn */
+int
+nlstats(NlStatsFn fn, void *arg)
+{
+	StatsArg sa;
+
+	sa.fn = fn;
+	sa.arg = arg;
+	if (nlopen() < 0)
+		return -1;
+	if (dump(&sa, RTM_GETLINK, handlestats) < 0) {
+		nlclose();
+		return -1;
+	}
+	return 0;
+}
@@ -0,0 +1,32 @@
+/* See LICENSE file for copyright and license details. */
+
+#include <linux/if_link.h>
+#include <net/if.h>
+#include <netinet/in.h>
+
+#define NLADDRLEN  INET6_ADDRSTRLEN
+
+typedef struct {
+	int index;
+	unsigned int flags;
+	int hasaddr;            /* carries an IPv4 or IPv6 address */
+	char name[IF_NAMESIZE];
+} NlLink;
+
+typedef struct {
+	NlLink *links;          /* owned by netlink.c, valid until the next nlquery() */
+	int nlinks;
+	int vpn;                /* a route points at a tun/tap/vpn device */
+	char ipaddr[NLADDRLEN]; /* preferred source of the default route */
+	char gateway[NLADDRLEN];
+} NlState;
+
+typedef void (*NlStatsFn)(void *arg, int index, unsigned int flags,
+                          const char *name, const struct rtnl_link_stats64 *st);
+
+int nlopen(void);
+void nlclose(void);
+int nlquery(NlState *st);
+int nlsubscribe(void);
+int nlevents(void);
+int nlstats(NlStatsFn fn, void *arg);
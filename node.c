@@ -0,0 +1,150 @@
+/* See LICENSE file for copyright and license details. */
+/* per-node memory, NUMA allocation counters and the cpu to node map */
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "node.h"
+
+#ifndef NODEDIR
+#define NODEDIR "/sys/devices/system/node"
+#endif
+
+static int readfd(int fd, char *buf, size_t size);
+static unsigned long long field(const char *buf, const char *key);
+static int mapcpus(NodeSet *ns, int idx, const char *list);
+
+static int
+readfd(int fd, char *buf, size_t size)
+{
+	ssize_t len;
+
+	if (fd < 0 || (len = pread(fd, buf, size - 1, 0)) <= 0)
+		return -1;
+	buf[len] = '\0';
+	return 0;
+}
+
+/* the number after key, which node meminfo prefixes with "Node N " */
+static unsigned long long
+field(const char *buf, const char *key)
+{
+	const char *p;
+
+	if (!(p = strstr(buf, key)))
+		return 0;
+	return strtoull(p + strlen(key), NULL, 10);
+}
+
+/* a cpulist is ranges like "0-15,32-47" */
+static int
+mapcpus(NodeSet *ns, int idx, const char *list)
+{
+	const char *p;
+	char *end;
+	long lo, hi, i;
+	int *q, n;
+
+	for (p = list; *p >= '0' && *p <= '9'; p = *end == ',' ? end + 1 : end) {
+		lo = hi = strtol(p, &end, 10);
+		if (*end == '-')
+			hi = strtol(end + 1, &end, 10);
+		if (hi < lo || hi > 65535)
+			return -1;
+		if (hi >= ns->ncpu) {
+			if (!(q = realloc(ns->cpunode, (hi + 1) * sizeof(*q))))
+				return -1;
+			for (n = ns->ncpu; n <= hi; n++)
+				q[n] = -1;
+			ns->cpunode = q;
+			ns->ncpu = hi + 1;
+		}
+		for (i = lo; i <= hi; i++)
+			ns->cpunode[i] = idx;
+		ns->n[idx].ncpus += hi - lo + 1;
+	}
+	return 0;
+}
+
+/*
+ * Find the nodes once, in id order; their files are held and only
+ * re-read afterwards. Ids can have holes, so they come from the
+ * directory rather than from counting up.
+ */
+int
+nodescan(NodeSet *ns)
+{
+	char path[128], buf[4096];
+	struct dirent *de;
+	Node *n;
+	DIR *d;
+	int ids[NODEMAX], nids, i, j, fd, id;
+
+	ns->scanned = 1;
+	if (!(d = opendir(NODEDIR)))
+		return -1;
+	nids = 0;
+	while ((de = readdir(d)) && nids < NODEMAX) {
+		if (strncmp(de->d_name, "node", 4) != 0 ||
+		    de->d_name[4] < '0' || de->d_name[4] > '9')
+			continue;
+		id = atoi(de->d_name + 4);
+		for (j = nids++; j > 0 && ids[j - 1] > id; j--)
+			ids[j] = ids[j - 1];
+		ids[j] = id;
+	}
+	closedir(d);
+
+	for (i = 0; i < nids; i++) {
+		n = &ns->n[i];
+		memset(n, 0, sizeof(*n));
+		n->id = ids[i];
+		snprintf(path, sizeof(path), NODEDIR "/node%d/meminfo", ids[i]);
+		n->meminfo = open(path, O_RDONLY | O_CLOEXEC);
+		snprintf(path, sizeof(path), NODEDIR "/node%d/numastat", ids[i]);
+		n->numastat = open(path, O_RDONLY | O_CLOEXEC);
+		snprintf(path, sizeof(path), NODEDIR "/node%d/cpulist", ids[i]);
+		if ((fd = open(path, O_RDONLY | O_CLOEXEC)) >= 0) {
+			if (readfd(fd, buf, sizeof(buf)) == 0)
+				mapcpus(ns, i, buf);
+			close(fd);
+		}
+	}
+	ns->count = nids;
+	return nids;
+}
+
+int
+noderead(NodeSet *ns, double now)
+{
+	char buf[4096];
+	unsigned long long miss, foreign;
+	double dt;
+	Node *n;
+	int i;
+
+	if (!ns->scanned)
+		nodescan(ns);
+	dt = ns->last > 0 ? now - ns->last : 0;
+	ns->last = now;
+	for (i = 0; i < ns->count; i++) {
+		n = &ns->n[i];
+		if (readfd(n->meminfo, buf, sizeof(buf)) == 0) {
+			n->memtotal = field(buf, "MemTotal:");
+			n->memfree = field(buf, "MemFree:");
+		}
+		if (readfd(n->numastat, buf, sizeof(buf)) < 0)
+			continue;
+		miss = field(buf, "numa_miss ");
+		foreign = field(buf, "numa_foreign ");
+		n->missps = dt > 0 && miss >= n->miss ? (miss - n->miss) / dt : 0;
+		n->foreignps = dt > 0 && foreign >= n->foreign ? (foreign - n->foreign) / dt : 0;
+		n->miss = miss;
+		n->foreign = foreign;
+	}
+	return ns->count;
+}
@@ -0,0 +1,26 @@
+/* See LICENSE file for copyright and license details. */
+
+#define NODEMAX 64
+
+typedef struct {
+	int id;
+	int meminfo;                        /* held node/meminfo */
+	int numastat;                       /* held node/numastat */
+	int ncpus;                          /* cpus in the node's cpulist */
+	unsigned long long memtotal;        /* kB */
+	unsigned long long memfree;         /* kB */
+	unsigned long long miss, foreign;   /* pages since boot */
+	double missps, foreignps;           /* pages per second over the last interval */
+} Node;
+
+typedef struct {
+	Node n[NODEMAX];
+	int count;
+	int *cpunode;                       /* node index of each cpu, -1 for none */
+	int ncpu;
+	int scanned;
+	double last;
+} NodeSet;
+
+int nodescan(NodeSet *ns);
+int noderead(NodeSet *ns, double now);
@@ -0,0 +1,443 @@
+/* See LICENSE file for copyright and license details. */
+/* incremental process scan over a held /proc dirfd */
+
+#define _GNU_SOURCE
+#include <fcntl.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include "hash.h"
+#include "proc.h"
+
+#define MINSLOTS 4096
+#define CHUNK    64   /* pids claimed per atomic step */
+
+/* the layout getdents64 fills in, which glibc does not export */
+struct linuxdirent64 {
+	unsigned long long d_ino;
+	long long d_off;
+	unsigned short d_reclen;
+	unsigned char d_type;
+	char d_name[];
+};
+
+/*
+ * One thread's share of a parallel scan: pids[next, end) still to be
+ * claimed, by the owner or by a thief, and the samples it has read so
+ * far. Padded so the cursors of different threads do not share a line.
+ */
+typedef struct {
+	unsigned int next;
+	unsigned int end;
+	Proc *out;
+	unsigned int nout;
+	unsigned int cap;
+} __attribute__((aligned(64))) Shard;
+
+/* a worker's shard and the generation it starts from, see startpool() */
+typedef struct {
+	int self;
+	unsigned int gen;
+} WorkerArg;
+
+/* what one scan hands the pool */
+typedef struct {
+	int nshards;
+	int dirfd;
+	const int *pids;
+} Job;
+
+static int grow(ProcTable *t);
+static Proc *lookup(ProcTable *t, int pid);
+static int readproc(int dirfd, int pid, Proc *p);
+static void update(ProcTable *t, const Proc *s);
+static int before(const Proc *a, const Proc *b, int key);
+static void runshard(int self, const Job *job);
+static void *worker(void *arg);
+static int startpool(int n);
+static int readall(ProcTable *t, int nthreads);
+
+static long clktck;
+static unsigned long long pagesize;
+
+/* the scan pool: shard 0 is the calling thread, 1..nworkers-1 sleep between scans */
+static Shard shards[PROCTHREADS];
+static int nworkers = 1;
+static pthread_mutex_t poollock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t poolwake = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t pooldone = PTHREAD_COND_INITIALIZER;
+static unsigned int poolgen;
+static int poolbusy;
+static Job pooljob;                     /* changes only under poollock */
+static WorkerArg workerargs[PROCTHREADS];
+
+static int
+grow(ProcTable *t)
+{
+	Proc *old, *slots;
+	unsigned int i, j, size, oldsize;
+
+	size = t->size ? t->size * 2 : MINSLOTS;
+	if (!(slots = calloc(size, sizeof(*slots))))
+		return -1;
+	old = t->slots;
+	oldsize = t->size;
+	t->slots = slots;
+	t->size = size;
+	for (i = 0; i < oldsize; i++) {
+		if (!old[i].pid)
+			continue;
+		j = hashfind(slots, sizeof(*slots), size, old[i].pid);
+		slots[j] = old[i];
+	}
+	free(old);
+	return 0;
+}
+
+/* find the slot for pid, claiming a free one if it is new */
+static Proc *
+lookup(ProcTable *t, int pid)
+{
+	Proc *p;
+
+	if ((t->n + 1) * 4 > t->size * 3 && grow(t) < 0)
+		return NULL;
+	p = &t->slots[hashfind(t->slots, sizeof(*p), t->size, pid)];
+	if (p->pid)
+		return p;
+	t->n++;
+	memset(p, 0, sizeof(*p));
+	p->pid = pid;
+	return p;
+}
+
+/*
+ * Fill p from /proc/<pid>/stat: "pid (comm) state ppid ..." where comm
+ * may itself hold spaces and parentheses, so fields are counted from
+ * the last ')'. utime and stime are fields 14 and 15, starttime 22 and
+ * rss 24.
+ */
+static int
+readproc(int dirfd, int pid, Proc *p)
+{
+	char path[32], buf[512], *s, *e;
+	unsigned long long v[24];
+	ssize_t len;
+	size_t n;
+	int fd, f;
+
+	snprintf(path, sizeof(path), "%d/stat", pid);
+	if ((fd = openat(dirfd, path, O_RDONLY | O_CLOEXEC)) < 0)
+		return -1;
+	len = pread(fd, buf, sizeof(buf) - 1, 0);
+	close(fd);
+	if (len <= 0)
+		return -1;
+	buf[len] = '\0';
+
+	if (!(s = strchr(buf, '(')) || !(e = strrchr(s, ')')) || e[1] != ' ')
+		return -1;
+	if ((n = e - s - 1) >= sizeof(p->comm))
+		n = sizeof(p->comm) - 1;
+	memcpy(p->comm, s + 1, n);
+	p->comm[n] = '\0';
+	p->state = e[2];
+
+	/* v[f] holds field f + 1, starting at ppid */
+	for (s = e + 3, f = 3; f < 24 && *s; f++) {
+		for (; *s == ' '; s++)
+			;
+		v[f] = 0;
+		if (*s == '-')
+			s++;
+		for (; (unsigned)(*s - '0') < 10; s++)
+			v[f] = v[f] * 10 + (*s - '0');
+	}
+	if (f < 24)
+		return -1;
+	p->pid = pid;
+	p->ticks = v[13] + v[14];
+	p->start = v[21];
+	p->rss = v[23] * pagesize;
+	return 0;
+}
+
+/* merge one fresh sample into the table */
+static void
+update(ProcTable *t, const Proc *s)
+{
+	Proc *p;
+
+	if (!(p = lookup(t, s->pid)))
+		return;
+	/* a reused pid or a first sighting has no previous counters */
+	if (p->gen && p->start == s->start && s->ticks >= p->ticks && t->dt > 0)
+		p->cpu = (s->ticks - p->ticks) * 100.0 / clktck / t->dt;
+	else
+		p->cpu = 0;
+	p->start = s->start;
+	p->ticks = s->ticks;
+	p->rss = s->rss;
+	p->state = s->state;
+	memcpy(p->comm, s->comm, sizeof(p->comm));
+	p->gen = t->gen;
+	if (s->state == 'R')
+		t->nrunning++;
+}
+
+/* read every pid in the shards, own range first, then steal from the others */
+static void
+runshard(int self, const Job *job)
+{
+	Shard *me, *victim;
+	Proc *out;
+	unsigned int i, end;
+	int k;
+
+	me = &shards[self];
+	me->nout = 0;
+	for (k = 0; k < job->nshards; k++) {
+		victim = &shards[(self + k) % job->nshards];
+		while ((i = __atomic_fetch_add(&victim->next, CHUNK, __ATOMIC_RELAXED)) < victim->end) {
+			end = i + CHUNK < victim->end ? i + CHUNK : victim->end;
+			for (; i < end; i++) {
+				if (me->nout == me->cap) {
+					if (!(out = realloc(me->out, (me->cap ? me->cap * 2 : 1024) * sizeof(*out))))
+						return;
+					me->out = out;
+					me->cap = me->cap ? me->cap * 2 : 1024;
+				}
+				if (readproc(job->dirfd, job->pids[i], &me->out[me->nout]) == 0)
+					me->nout++;
+			}
+		}
+	}
+}
+
+static void *
+worker(void *arg)
+{
+	const WorkerArg *wa = arg;
+	int self = wa->self;
+	unsigned int seen = wa->gen;
+	Job job;
+
+	for (;;) {
+		pthread_mutex_lock(&poollock);
+		while (seen == poolgen)
+			pthread_cond_wait(&poolwake, &poollock);
+		seen = poolgen;
+		/* copied with the generation, so a late wake cannot see the next job */
+		job = pooljob;
+		pthread_mutex_unlock(&poollock);
+
+		if (self >= job.nshards)
+			continue;
+		runshard(self, &job);
+
+		pthread_mutex_lock(&poollock);
+		if (--poolbusy == 0)
+			pthread_cond_signal(&pooldone);
+		pthread_mutex_unlock(&poollock);
+	}
+	return NULL;
+}
+
+/* grow the pool to n threads including the caller, return how many there are */
+static int
+startpool(int n)
+{
+	pthread_attr_t attr;
+	pthread_t tid;
+
+	pthread_attr_init(&attr);
+	pthread_attr_setdetachstate(&attr, PTHREAD_CREATE_DETACHED);
+	pthread_attr_setstacksize(&attr, 64 * 1024);
+	for (; nworkers < n; nworkers++) {
+		/*
+		 * A worker added after earlier scans must not take the
+		 * current generation for a new job, or it would run with
+		 * no job and count itself off poolbusy.
+		 */
+		workerargs[nworkers].self = nworkers;
+		pthread_mutex_lock(&poollock);
+		workerargs[nworkers].gen = poolgen;
+		pthread_mutex_unlock(&poollock);
+		if (pthread_create(&tid, &attr, worker, &workerargs[nworkers]) != 0)
+			break;
+	}
+	pthread_attr_destroy(&attr);
+	return nworkers < n ? nworkers : n;
+}
+
+/*
+ * Read the stat of every collected pid, split into one contiguous pid
+ * range per thread. Small tables stay on the calling thread, where the
+ * hand-off would cost more than it saves.
+ */
+static int
+readall(ProcTable *t, int nthreads)
+{
+	Job job;
+	unsigned int per;
+	int i;
+
+	if (nthreads > PROCTHREADS)
+		nthreads = PROCTHREADS;
+	if (nthreads < 1 || t->npids < (unsigned int)nthreads * CHUNK * 4)
+		nthreads = 1;
+	nthreads = startpool(nthreads);
+
+	per = (t->npids + nthreads - 1) / nthreads;
+	for (i = 0; i < nthreads; i++) {
+		shards[i].next = i * per < t->npids ? i * per : t->npids;
+		shards[i].end = (i + 1) * per < t->npids ? (i + 1) * per : t->npids;
+	}
+	job.nshards = nthreads;
+	job.dirfd = t->dirfd;
+	job.pids = t->pids;
+
+	if (nthreads > 1) {
+		pthread_mutex_lock(&poollock);
+		pooljob = job;
+		poolbusy = nthreads - 1;
+		poolgen++;
+		pthread_cond_broadcast(&poolwake);
+		pthread_mutex_unlock(&poollock);
+	}
+	runshard(0, &job);
+	if (nthreads > 1) {
+		pthread_mutex_lock(&poollock);
+		while (poolbusy > 0)
+			pthread_cond_wait(&pooldone, &poollock);
+		pthread_mutex_unlock(&poollock);
+	}
+	return nthreads;
+}
+
+/*
+ * Walk root, normally /proc, with raw getdents64 on the held dirfd,
+ * read each numeric entry's stat relative to it on up to nthreads
+ * threads, then merge the per-thread samples into the table on this
+ * one. Processes not seen this time are dropped from the table. root
+ * is only opened on the first scan.
+ */
+int
+procscan(ProcTable *t, const char *root, double now, int nthreads)
+{
+	char dents[32768];
+	struct linuxdirent64 *d;
+	const char *c;
+	long n, off;
+	unsigned int i, j, cap;
+	int pid, *pids;
+
+	if (!clktck) {
+		clktck = sysconf(_SC_CLK_TCK);
+		pagesize = sysconf(_SC_PAGESIZE);
+	}
+	if (t->dirfd < 0 &&
+	    (t->dirfd = open(root, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+		return -1;
+	if (lseek(t->dirfd, 0, SEEK_SET) < 0)
+		return -1;
+
+	t->npids = 0;
+	while ((n = syscall(SYS_getdents64, t->dirfd, dents, sizeof(dents))) > 0) {
+		for (off = 0; off < n; off += d->d_reclen) {
+			d = (struct linuxdirent64 *)(dents + off);
+			for (pid = 0, c = d->d_name; (unsigned)(*c - '0') < 10; c++)
+				pid = pid * 10 + (*c - '0');
+			if (*c || pid <= 0)
+				continue;
+			if (t->npids == t->pidcap) {
+				cap = t->pidcap ? t->pidcap * 2 : 1024;
+				if (!(pids = realloc(t->pids, cap * sizeof(*pids))))
+					return -1;
+				t->pids = pids;
+				t->pidcap = cap;
+			}
+			t->pids[t->npids++] = pid;
+		}
+	}
+	if (n < 0)
+		return -1;
+
+	t->dt = t->last > 0 ? now - t->last : 0;
+	t->last = now;
+	if (++t->gen == 0)
+		t->gen = 1;
+	t->nrunning = 0;
+
+	nthreads = readall(t, nthreads);
+	for (i = 0; i < (unsigned int)nthreads; i++)
+		for (j = 0; j < shards[i].nout; j++)
+			update(t, &shards[i].out[j]);
+
+	for (i = 0; i < t->size;) {
+		if (t->slots[i].pid && t->slots[i].gen != t->gen) {
+			hashdel(t->slots, sizeof(t->slots[0]), t->size, i); /* may shift another entry into i */
+			t->n--;
+		} else {
+			i++;
+		}
+	}
+	return t->n;
+}
+
+static int
+before(const Proc *a, const Proc *b, int key)
+{
+	if (key == ProcByRss)
+		return a->rss > b->rss;
+	return a->cpu > b->cpu || (a->cpu == b->cpu && a->rss > b->rss);
+}
+
+/*
+ * The n largest processes by key, largest first. A min-heap of n
+ * entries keeps the selection at O(size log n) rather than sorting the
+ * whole table, and only the n winners are sorted at the end.
+ */
+int
+proctop(const ProcTable *t, Proc *top, int n, int key)
+{
+	const Proc *p;
+	Proc tmp;
+	unsigned int i;
+	int count, j, c;
+
+	count = 0;
+	for (i = 0; i < t->size && n > 0; i++) {
+		p = &t->slots[i];
+		if (!p->pid)
+			continue;
+		if (count < n) {
+			/* sift up */
+			for (j = count++; j > 0 && before(&top[(j - 1) / 2], p, key); j = (j - 1) / 2)
+				top[j] = top[(j - 1) / 2];
+			top[j] = *p;
+		} else if (before(p, &top[0], key)) {
+			/* replace the smallest and sift down */
+			for (j = 0; (c = 2 * j + 1) < count; j = c) {
+				if (c + 1 < count && before(&top[c], &top[c + 1], key))
+					c++;
+				if (!before(p, &top[c], key))
+					break;
+				top[j] = top[c];
+			}
+			top[j] = *p;
+		}
+	}
+
+	for (j = 1; j < count; j++) {
+		tmp = top[j];
+		for (c = j; c > 0 && before(&tmp, &top[c - 1], key); c--)
+			top[c] = top[c - 1];
+		top[c] = tmp;
+	}
+	return count;
+}
@@ -0,0 +1,34 @@
+/* See LICENSE file for copyright and license details. */
+
+#define PROCTHREADS 8 /* most threads a scan is split across */
+
+enum { ProcByCpu, ProcByRss };
+
+typedef struct {
+	int pid;                    /* 0 marks a free slot */
+	unsigned int gen;           /* last scan the process was seen in */
+	unsigned long long start;   /* start time in ticks, tells a reused pid apart */
+	unsigned long long ticks;   /* utime + stime */
+	unsigned long long rss;     /* bytes */
+	double cpu;                 /* percent of one cpu over the last interval */
+	char state;
+	char comm[16];
+} Proc;
+
+/* open-addressed table of processes keyed by pid, grown on demand */
+typedef struct {
+	Proc *slots;
+	unsigned int size;          /* power of two, kept at most 3/4 full */
+	unsigned int n;
+	unsigned int nrunning;
+	unsigned int gen;
+	double last;
+	double dt;
+	int dirfd;                  /* the scanned root held open between scans, -1 until the first */
+	int *pids;                  /* this scan's pids, in directory order */
+	unsigned int npids;
+	unsigned int pidcap;
+} ProcTable;
+
+int procscan(ProcTable *t, const char *root, double now, int nthreads);
+int proctop(const ProcTable *t, Proc *top, int n, int key);
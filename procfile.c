@@ -0,0 +1,58 @@
+/* See LICENSE file for copyright and license details. */
+/* persistent pread-based file reader */
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "procfile.h"
+
+#define PFINITSIZ 4096
+
+/*
+ * Read the whole file from offset 0 into the buffer and NUL-terminate it.
+ * The descriptor is opened on first use and kept; the buffer only grows
+ * when a file no longer fits, so steady-state reads are a single pread.
+ */
+char *
+pfread(ProcFile *pf)
+{
+	ssize_t n;
+	char *p;
+
+	if (pf->fd < 0 && (pf->fd = open(pf->path, O_RDONLY | O_CLOEXEC)) < 0)
+		return NULL;
+	if (!pf->buf) {
+		if (!(pf->buf = malloc(PFINITSIZ)))
+			return NULL;
+		pf->size = PFINITSIZ;
+	}
+
+	for (;;) {
+		n = pread(pf->fd, pf->buf, pf->size - 1, 0);
+		if (n < 0) {
+			if (errno == EINTR)
+				continue;
+			pfclose(pf);
+			return NULL;
+		}
+		if ((size_t)n < pf->size - 1)
+			break;
+		if (!(p = realloc(pf->buf, pf->size * 2)))
+			break;
+		pf->buf = p;
+		pf->size *= 2;
+	}
+	pf->len = n;
+	pf->buf[n] = '\0';
+	return pf->buf;
+}
+
+void
+pfclose(ProcFile *pf)
+{
+	if (pf->fd >= 0)
+		close(pf->fd);
+	pf->fd = -1;
+}
@@ -0,0 +1,17 @@
+/* See LICENSE file for copyright and license details. */
+
+#include <stddef.h>
+
+/* a /proc, /sys or /etc file held open and re-read in place */
+typedef struct {
+	const char *path;
+	int fd;
+	char *buf;
+	size_t size;
+	size_t len;
+} ProcFile;
+
+#define PROCFILE(path) { (path), -1, NULL, 0, 0 }
+
+char *pfread(ProcFile *pf);
+void pfclose(ProcFile *pf);
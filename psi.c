@@ -0,0 +1,62 @@
+/* See LICENSE file for copyright and license details. */
+/* pressure stall information from /proc/pressure */
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "psi.h"
+
+static const char *avg(const char *line, const char *key, double *v);
+
+/* the number after key, e.g. "avg10=" in "some avg10=0.12 avg60=..." */
+static const char *
+avg(const char *line, const char *key, double *v)
+{
+	const char *p;
+
+	if (!(p = strstr(line, key)))
+		return NULL;
+	*v = strtod(p + strlen(key), (char **)&p);
+	return p;
+}
+
+int
+psiparse(const char *buf, Pressure *p)
+{
+	const char *line, *end;
+
+	memset(p, 0, sizeof(*p));
+	for (line = buf; *line; line = *end ? end + 1 : end) {
+		if (!(end = strchr(line, '\n')))
+			end = line + strlen(line);
+		if (!strncmp(line, "some ", 5))
+			p->valid = avg(line, "avg10=", &p->some10) && avg(line, "avg60=", &p->some60);
+		else if (!strncmp(line, "full ", 5))
+			p->hasfull = avg(line, "avg10=", &p->full10) && avg(line, "avg60=", &p->full60);
+	}
+	return p->valid ? 0 : -1;
+}
+
+/*
+ * Register a trigger that fires once some tasks have stalled for stallus
+ * within a windowus window, and return the fd to poll for POLLPRI.
+ * Unprivileged callers need a window that is a multiple of 2s.
+ */
+int
+psitrigger(const char *path, unsigned int stallus, unsigned int windowus)
+{
+	char buf[64];
+	int fd, len;
+
+	if ((fd = open(path, O_RDWR | O_NONBLOCK | O_CLOEXEC)) < 0)
+		return -1;
+	len = snprintf(buf, sizeof(buf), "some %u %u", stallus, windowus);
+	if (write(fd, buf, len + 1) < 0) {
+		close(fd);
+		return -1;
+	}
+	return fd;
+}
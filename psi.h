@@ -0,0 +1,13 @@
+/* See LICENSE file for copyright and license details. */
+
+enum { PsiCpu, PsiMemory, PsiIo, PsiLast };
+
+typedef struct {
+	int valid;
+	int hasfull;             /* cpu has no full line before 5.13 */
+	double some10, some60;   /* percent of time some tasks stalled */
+	double full10, full60;   /* percent of time all tasks stalled */
+} Pressure;
+
+int psiparse(const char *buf, Pressure *p);
+int psitrigger(const char *path, unsigned int stallus, unsigned int windowus);
@@ -0,0 +1,247 @@
+/* See LICENSE file for copyright and license details. */
+/* hwmon and thermal zone sensors read through held fds */
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "sensors.h"
+
+#ifndef HWMONDIR
+#define HWMONDIR   "/sys/class/hwmon"
+#endif
+#ifndef THERMALDIR
+#define THERMALDIR "/sys/class/thermal"
+#endif
+
+static void setname(char *dst, size_t size, const char *src, size_t len);
+static int readsmall(int dfd, const char *name, char *buf, size_t size);
+static double readvalue(int dfd, const char *name, double unit);
+static Sensor *addsensor(SensorSet *set, int kind, int dfd, const char *input);
+static void scanhwmon(SensorSet *set, int dfd);
+static void scanthermal(SensorSet *set, int dfd, const char *zone);
+static int cmpsensor(const void *a, const void *b);
+
+static const struct {
+	const char *prefix;
+	int kind;
+} inputs[] = {
+	{ "temp", SensorTemp },
+	{ "fan",  SensorFan },
+	{ "in",   SensorVolt },
+};
+
+/* sysfs units per displayed unit: millidegrees, RPM, millivolts */
+static const double scale[] = {
+	[SensorTemp] = 1000,
+	[SensorFan]  = 1,
+	[SensorVolt] = 1000,
+};
+
+static void
+setname(char *dst, size_t size, const char *src, size_t len)
+{
+	if (len >= size)
+		len = size - 1;
+	memcpy(dst, src, len);
+	dst[len] = '\0';
+}
+
+/* read a short attribute of the directory dfd, without its trailing newline */
+static int
+readsmall(int dfd, const char *name, char *buf, size_t size)
+{
+	ssize_t len;
+	int fd;
+
+	if ((fd = openat(dfd, name, O_RDONLY | O_CLOEXEC)) < 0)
+		return -1;
+	len = read(fd, buf, size - 1);
+	close(fd);
+	if (len <= 0)
+		return -1;
+	buf[len] = '\0';
+	buf[strcspn(buf, "\n")] = '\0';
+	return 0;
+}
+
+static double
+readvalue(int dfd, const char *name, double unit)
+{
+	char buf[32];
+
+	if (readsmall(dfd, name, buf, sizeof(buf)) < 0)
+		return 0;
+	return strtol(buf, NULL, 10) / unit;
+}
+
+static Sensor *
+addsensor(SensorSet *set, int kind, int dfd, const char *input)
+{
+	Sensor *s;
+	int fd;
+
+	if (set->n >= SENSORMAX || (fd = openat(dfd, input, O_RDONLY | O_CLOEXEC)) < 0)
+		return NULL;
+	s = &set->s[set->n++];
+	memset(s, 0, sizeof(*s));
+	s->kind = kind;
+	s->fd = fd;
+	return s;
+}
+
+/* every temp*_input, fan*_input and in*_input of one hwmon chip; takes dfd */
+static void
+scanhwmon(SensorSet *set, int dfd)
+{
+	char attr[64], chip[24];
+	struct dirent *e;
+	size_t i, plen;
+	const char *idx;
+	Sensor *s;
+	DIR *d;
+
+	if (readsmall(dfd, "name", chip, sizeof(chip)) < 0 || !(d = fdopendir(dfd))) {
+		close(dfd);
+		return;
+	}
+	while ((e = readdir(d))) {
+		for (i = 0; i < sizeof(inputs) / sizeof(inputs[0]); i++) {
+			plen = strlen(inputs[i].prefix);
+			if (strncmp(e->d_name, inputs[i].prefix, plen) != 0)
+				continue;
+			for (idx = e->d_name + plen; *idx >= '0' && *idx <= '9'; idx++)
+				;
+			if (idx == e->d_name + plen || strcmp(idx, "_input") != 0)
+				continue;
+			/* tempN_input -> tempN_label, tempN_max, tempN_crit */
+			if ((plen = idx - e->d_name) + sizeof("_label") > sizeof(attr))
+				break;
+			if (!(s = addsensor(set, inputs[i].kind, dirfd(d), e->d_name)))
+				break;
+			memcpy(s->chip, chip, sizeof(s->chip));
+			memcpy(attr, e->d_name, plen);
+			strcpy(attr + plen, "_label");
+			if (readsmall(dirfd(d), attr, s->label, sizeof(s->label)) < 0)
+				setname(s->label, sizeof(s->label), e->d_name, plen);
+			if (s->kind == SensorTemp) {
+				strcpy(attr + plen, "_max");
+				s->max = readvalue(dirfd(d), attr, scale[SensorTemp]);
+				strcpy(attr + plen, "_crit");
+				s->crit = readvalue(dirfd(d), attr, scale[SensorTemp]);
+			}
+			break;
+		}
+	}
+	closedir(d);
+}
+
+/* a thermal zone's temp, with its hot/passive and critical trip points */
+static void
+scanthermal(SensorSet *set, int dfd, const char *zone)
+{
+	char attr[64], type[24];
+	double v;
+	Sensor *s;
+	int i;
+
+	if (!(s = addsensor(set, SensorTemp, dfd, "temp")))
+		return;
+	if (readsmall(dfd, "type", s->chip, sizeof(s->chip)) < 0)
+		strcpy(s->chip, "thermal");
+	setname(s->label, sizeof(s->label), zone, strlen(zone));
+
+	for (i = 0; ; i++) {
+		snprintf(attr, sizeof(attr), "trip_point_%d_type", i);
+		if (readsmall(dfd, attr, type, sizeof(type)) < 0)
+			break;
+		snprintf(attr, sizeof(attr), "trip_point_%d_temp", i);
+		v = readvalue(dfd, attr, scale[SensorTemp]);
+		if (!strcmp(type, "critical"))
+			s->crit = v;
+		else if ((!strcmp(type, "hot") || !strcmp(type, "passive")) && (!s->max || v < s->max))
+			s->max = v;
+	}
+}
+
+static int
+cmpsensor(const void *a, const void *b)
+{
+	const Sensor *x = a, *y = b;
+	int c;
+
+	if (x->kind != y->kind)
+		return x->kind - y->kind;
+	if ((c = strcmp(x->chip, y->chip)))
+		return c;
+	return strcmp(x->label, y->label);
+}
+
+/*
+ * Walk hwmon and the thermal zones once, opening every input and
+ * reading the static label and thresholds up front, so a tick is only
+ * the preads in sensorread().
+ */
+int
+sensorscan(SensorSet *set)
+{
+	struct dirent *e;
+	DIR *d;
+	int i, fd;
+
+	for (i = 0; i < set->n; i++)
+		close(set->s[i].fd);
+	set->n = 0;
+	set->scanned = 1;
+
+	if ((d = opendir(HWMONDIR))) {
+		while ((e = readdir(d)))
+			if (!strncmp(e->d_name, "hwmon", 5) &&
+			    (fd = openat(dirfd(d), e->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) >= 0)
+				scanhwmon(set, fd);
+		closedir(d);
+	}
+	if ((d = opendir(THERMALDIR))) {
+		while ((e = readdir(d))) {
+			if (strncmp(e->d_name, "thermal_zone", 12) != 0 ||
+			    (fd = openat(dirfd(d), e->d_name, O_RDONLY | O_DIRECTORY | O_CLOEXEC)) < 0)
+				continue;
+			scanthermal(set, fd, e->d_name);
+			close(fd);
+		}
+		closedir(d);
+	}
+	qsort(set->s, set->n, sizeof(set->s[0]), cmpsensor);
+	return set->n;
+}
+
+/* one pread per held input */
+int
+sensorread(SensorSet *set)
+{
+	char buf[32];
+	ssize_t len;
+	Sensor *s;
+	int i;
+
+	if (!set->scanned)
+		sensorscan(set);
+	for (i = 0; i < set->n; i++) {
+		s = &set->s[i];
+		if ((len = pread(s->fd, buf, sizeof(buf) - 1, 0)) <= 0) {
+			/* some drivers fail a read now and then; only a gone device rescans */
+			if (len < 0 && errno == ENODEV)
+				set->scanned = 0;
+			s->valid = 0;
+			continue;
+		}
+		buf[len] = '\0';
+		s->value = strtol(buf, NULL, 10) / scale[s->kind];
+		s->valid = 1;
+	}
+	return set->n;
+}
@@ -0,0 +1,24 @@
+/* See LICENSE file for copyright and license details. */
+
+#define SENSORMAX 64
+
+enum { SensorTemp, SensorFan, SensorVolt };
+
+typedef struct {
+	int kind;
+	int fd;                  /* the held *_input or temp file */
+	int valid;               /* the last read succeeded */
+	char chip[24];           /* hwmon name or thermal zone type */
+	char label[24];          /* *_label, else the input's own name */
+	double value;            /* degrees C, RPM or volts */
+	double max, crit;        /* temperature thresholds, 0 when unknown */
+} Sensor;
+
+typedef struct {
+	Sensor s[SENSORMAX];
+	int n;
+	int scanned;             /* discovery has run since the last failure */
+} SensorSet;
+
+int sensorscan(SensorSet *set);
+int sensorread(SensorSet *set);
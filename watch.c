@@ -0,0 +1,142 @@
+/* See LICENSE file for copyright and license details. */
+/* inotify invalidation of configuration files */
+
+#include <errno.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <unistd.h>
+
+#include "watch.h"
+
+#define WATCHMAX  32
+#define WATCHMASK (IN_CLOSE_WRITE | IN_MOVED_TO | IN_CREATE)
+
+typedef struct {
+	int wd;
+	int id;
+	char name[NAME_MAX + 1];
+} Watch;
+
+static int adddir(const char *path, int id);
+static void rewatch(unsigned int ids);
+
+static int watchfd = -1;
+static Watch watches[WATCHMAX];
+static int nwatches;
+static const char *files[WATCHMAX];
+static int fileids[WATCHMAX];
+static int nfiles;
+
+int
+watchinit(void)
+{
+	if (watchfd < 0)
+		watchfd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+	return watchfd;
+}
+
+/* watch the directory holding path for writes or renames onto its name */
+static int
+adddir(const char *path, int id)
+{
+	char dir[PATH_MAX];
+	const char *base;
+	int i, wd;
+
+	if (!(base = strrchr(path, '/')) || (size_t)(base - path) >= sizeof(dir))
+		return -1;
+	memcpy(dir, path, base - path);
+	dir[base - path] = '\0';
+	base++;
+
+	if ((wd = inotify_add_watch(watchfd, dir[0] ? dir : "/", WATCHMASK)) < 0)
+		return -1;
+	for (i = 0; i < nwatches; i++)
+		if (watches[i].wd == wd && watches[i].id == id && !strcmp(watches[i].name, base))
+			return 0;
+	if (nwatches >= WATCHMAX)
+		return -1;
+	watches[nwatches].wd = wd;
+	watches[nwatches].id = id;
+	strncpy(watches[nwatches].name, base, NAME_MAX);
+	nwatches++;
+	return 0;
+}
+
+/*
+ * Watch both the path and, when it is a symlink as resolv.conf and
+ * os-release usually are, the file it currently resolves to.
+ */
+int
+watchfile(const char *path, int id)
+{
+	char *real;
+	int ret;
+
+	if (watchfd < 0)
+		return -1;
+	if (nfiles < WATCHMAX) {
+		files[nfiles] = path;
+		fileids[nfiles] = id;
+		nfiles++;
+	}
+
+	ret = adddir(path, id);
+	if ((real = realpath(path, NULL))) {
+		if (strcmp(real, path) != 0)
+			adddir(real, id);
+		free(real);
+	}
+	return ret;
+}
+
+/* a replaced symlink may now point somewhere else */
+static void
+rewatch(unsigned int ids)
+{
+	char *real;
+	int i;
+
+	for (i = 0; i < nfiles; i++) {
+		if (!(ids & (1u << fileids[i])) || !(real = realpath(files[i], NULL)))
+			continue;
+		adddir(real, fileids[i]);
+		free(real);
+	}
+}
+
+/* drain pending events and return the ids of the files that changed */
+unsigned int
+watchevents(void)
+{
+	char buf[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+	const struct inotify_event *ev;
+	unsigned int ids;
+	ssize_t len;
+	char *p;
+	int i;
+
+	ids = 0;
+	for (;;) {
+		if ((len = read(watchfd, buf, sizeof(buf))) < 0) {
+			if (errno == EINTR)
+				continue;
+			break;
+		}
+		for (p = buf; p < buf + len; p += sizeof(*ev) + ev->len) {
+			ev = (const struct inotify_event *)p;
+			if (ev->mask & IN_Q_OVERFLOW) {
+				ids = ~0u;
+				continue;
+			}
+			for (i = 0; i < nwatches; i++)
+				if (watches[i].wd == ev->wd && ev->len && !strcmp(watches[i].name, ev->name))
+					ids |= 1u << watches[i].id;
+		}
+	}
+	if (ids)
+		rewatch(ids);
+	return ids;
+}
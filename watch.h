@@ -0,0 +1,5 @@
+/* See LICENSE file for copyright and license details. */
+
+int watchinit(void);
+int watchfile(const char *path, int id);
+unsigned int watchevents(void);